@@ -0,0 +1,188 @@
+/** @file affinita.c
+
+	@brief Libreria per il posizionamento dei figli su CPU e nodi NUMA.
+ */
+#define _GNU_SOURCE
+#include "affinita.h"
+
+#include <sched.h>
+#include <sys/syscall.h>
+
+#define MAX_NODI 64			/* N° massimo di nodi NUMA gestiti */
+#define MPOL_PREFERRED 1	/* Politica di mbind(): nodo preferito */
+#define MPOL_MF_MOVE 2		/* Flag di mbind(): sposta le pagine già allocate */
+
+/**
+	@brief Funzione di lettura di un file di testo di /sys
+
+	@param percorso Percorso del file
+	@param buffer Buffer in cui salvare il contenuto, terminato da '\0'
+	@param n Dimensione del buffer
+	@return 0 in caso di successo, -1 se il file non esiste o non è leggibile
+ */
+static int leggi_sys(const char* percorso, char* buffer, size_t n){
+    int fd;
+    ssize_t letti;
+    
+    if((fd = open(percorso, O_RDONLY)) == -1)
+        return -1;
+    
+    letti = read(fd, buffer, n - 1);
+    close(fd);
+    
+    if(letti <= 0)
+        return -1;
+    
+    buffer[letti] = '\0';
+    
+    return 0;
+}
+
+/**
+	@brief Funzione di analisi di una lista di CPU
+
+	@param lista Lista di CPU nel formato di cpulist (es. "0-3,8,10-11")
+	@param cpu Vettore in cui salvare le CPU nell'ordine della lista
+	@param max Dimensione del vettore cpu
+	@return N° di CPU lette, -1 se la lista non è valida
+ */
+int affinita_lista(const char* lista, int* cpu, int max){
+    const char* p = lista;
+    char* fine;
+    long inizio, ultimo;
+    int n = 0;
+    
+    while(*p != '\0' && *p != '\n'){
+        inizio = strtol(p, &fine, 10);
+        if(fine == p || inizio < 0 || inizio >= MAX_CPU)
+            return -1;
+        
+        ultimo = inizio;
+        p = fine;
+        
+        if(*p == '-'){
+            ultimo = strtol(p + 1, &fine, 10);
+            if(fine == p + 1 || ultimo < inizio || ultimo >= MAX_CPU)
+                return -1;
+            p = fine;
+        }
+        
+        for(; inizio <= ultimo && n < max; inizio++)
+            cpu[n++] = inizio;
+        
+        if(*p == ',')
+            p++;
+        else if(*p != '\0' && *p != '\n')
+            return -1;
+    }
+    
+    return n > 0 ? n : -1;
+}
+
+/**
+	@brief Funzione che restituisce il nodo NUMA di una CPU
+
+	@param cpu N° della CPU
+	@return N° del nodo, 0 se il sistema non espone la topologia NUMA
+ */
+int affinita_nodo(int cpu){
+    char percorso[64];
+    char lista[4096];
+    int cpu_nodo[MAX_CPU];
+    int nodo, n, i;
+    
+    for(nodo=0; nodo<MAX_NODI; nodo++){
+        sprintf(percorso, "/sys/devices/system/node/node%d/cpulist", nodo);
+        
+        if(leggi_sys(percorso, lista, sizeof(lista)) == -1)
+            continue;
+        
+        n = affinita_lista(lista, cpu_nodo, MAX_CPU);
+        for(i=0; i<n; i++)
+            if(cpu_nodo[i] == cpu)
+                return nodo;
+    }
+    
+    return 0;
+}
+
+/**
+	@brief Funzione che ricava la lista di CPU predefinita dalla topologia
+
+	Considera solo le CPU su cui il processo può essere eseguito.
+	@param cpu Vettore in cui salvare le CPU in ordine di assegnazione
+	@param max Dimensione del vettore cpu
+	@return N° di CPU, -1 in caso di errore
+ */
+int affinita_topologia(int* cpu, int max){
+    cpu_set_t consentite;
+    char percorso[96];
+    char lista[4096];
+    int nodo_cpu[MAX_CPU];		/* Nodo di ciascuna CPU consentita, -1 se non consentita */
+    int primo_fratello[MAX_CPU];	/* Primo thread hardware del core di ciascuna CPU */
+    int fratelli[MAX_CPU];
+    int nodo_padre, passo, giro, nodo, c, n = 0;
+    
+    if(sched_getaffinity(0, sizeof(consentite), &consentite) == -1)
+        return -1;
+    
+    for(c=0; c<MAX_CPU; c++){
+        nodo_cpu[c] = CPU_ISSET(c, &consentite) ? affinita_nodo(c) : -1;
+        primo_fratello[c] = c;
+        
+        sprintf(percorso, "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", c);
+        if(nodo_cpu[c] != -1 && leggi_sys(percorso, lista, sizeof(lista)) == 0 &&
+           affinita_lista(lista, fratelli, MAX_CPU) > 0)
+            primo_fratello[c] = fratelli[0];
+    }
+    
+    /**
+     Scorro i nodi a partire da quello su cui gira il padre e, per ciascun
+     nodo, prima i primi thread hardware dei core e poi gli altri.
+     */
+    nodo_padre = (c = sched_getcpu()) >= 0 ? affinita_nodo(c) : 0;
+    
+    for(giro=0; giro<MAX_NODI; giro++){
+        nodo = (nodo_padre + giro) % MAX_NODI;
+        
+        for(passo=0; passo<2; passo++)
+            for(c=0; c<MAX_CPU && n<max; c++)
+                if(nodo_cpu[c] == nodo && (primo_fratello[c] == c) == (passo == 0))
+                    cpu[n++] = c;
+    }
+    
+    return n > 0 ? n : -1;
+}
+
+/**
+	@brief Funzione che fissa il thread chiamante a una CPU
+
+	L'affinità è ereditata dai processi creati con fork() e mantenuta da execvp().
+	@param cpu N° della CPU
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int affinita_fissa(int cpu){
+    cpu_set_t insieme;
+    
+    CPU_ZERO(&insieme);
+    CPU_SET(cpu, &insieme);
+    
+    return sched_setaffinity(0, sizeof(insieme), &insieme);
+}
+
+/**
+	@brief Funzione che sposta una zona di memoria su un nodo NUMA
+
+	Imposta il nodo come preferito per le pagine della zona e vi sposta
+	quelle già allocate.<br>
+	La system call mbind() è invocata direttamente, senza libnuma.
+	@param indirizzo Inizio della zona, allineato alla pagina
+	@param n Dimensione in byte della zona
+	@param nodo N° del nodo NUMA
+	@return 0 in caso di successo, -1 in caso di errore (es. kernel senza NUMA)
+ */
+int affinita_memoria(void* indirizzo, size_t n, int nodo){
+    unsigned long maschera = 1UL << nodo;
+    
+    return syscall(SYS_mbind, indirizzo, n, MPOL_PREFERRED, &maschera, sizeof(maschera) * 8, MPOL_MF_MOVE) == -1 ? -1 : 0;
+}
@@ -0,0 +1,70 @@
+/** @file affinita.h
+
+	@brief Libreria per il posizionamento dei figli su CPU e nodi NUMA.
+
+	Con l'opzione -c di elab2 ogni figlio viene fissato a una CPU di una
+	lista (il figlio id alla CPU id-esima, ciclicamente) con sched_setaffinity()
+	e il suo canale viene spostato sul nodo NUMA di quella CPU con mbind().<br>
+	La lista predefinita ("auto") è ricavata dalla topologia in
+	/sys/devices/system: prima le CPU del nodo su cui gira il padre, poi
+	quelle degli altri nodi; all'interno di un nodo prima un solo thread
+	hardware per core fisico, poi gli altri.
+ */
+
+#ifndef AFFINITA_H
+#define AFFINITA_H
+
+#include "functions.h"
+
+#define MAX_CPU 1024	/**< N° massimo di CPU gestite */
+
+/**
+	@brief Funzione di analisi di una lista di CPU
+
+	@param lista Lista di CPU nel formato di cpulist (es. "0-3,8,10-11")
+	@param cpu Vettore in cui salvare le CPU nell'ordine della lista
+	@param max Dimensione del vettore cpu
+	@return N° di CPU lette, -1 se la lista non è valida
+ */
+int affinita_lista(const char* lista, int* cpu, int max);
+
+/**
+	@brief Funzione che ricava la lista di CPU predefinita dalla topologia
+
+	Considera solo le CPU su cui il processo può essere eseguito.
+	@param cpu Vettore in cui salvare le CPU in ordine di assegnazione
+	@param max Dimensione del vettore cpu
+	@return N° di CPU, -1 in caso di errore
+ */
+int affinita_topologia(int* cpu, int max);
+
+/**
+	@brief Funzione che restituisce il nodo NUMA di una CPU
+
+	@param cpu N° della CPU
+	@return N° del nodo, 0 se il sistema non espone la topologia NUMA
+ */
+int affinita_nodo(int cpu);
+
+/**
+	@brief Funzione che fissa il thread chiamante a una CPU
+
+	L'affinità è ereditata dai processi creati con fork() e mantenuta da execvp().
+	@param cpu N° della CPU
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int affinita_fissa(int cpu);
+
+/**
+	@brief Funzione che sposta una zona di memoria su un nodo NUMA
+
+	Imposta il nodo come preferito per le pagine della zona e vi sposta
+	quelle già allocate.
+	@param indirizzo Inizio della zona, allineato alla pagina
+	@param n Dimensione in byte della zona
+	@param nodo N° del nodo NUMA
+	@return 0 in caso di successo, -1 in caso di errore (es. kernel senza NUMA)
+ */
+int affinita_memoria(void* indirizzo, size_t n, int nodo);
+
+#endif
@@ -0,0 +1,211 @@
+/** @file appoggio.c
+
+	@brief Libreria per l'area di appoggio del vettore dei risultati.
+ */
+#include "appoggio.h"
+
+#include <sys/mman.h>
+
+#ifndef SHM_HUGETLB
+#define SHM_HUGETLB 04000	/* Flag di shmget() per le pagine enormi */
+#endif
+
+#define PAGINA_ENORME_PREDEFINITA (2 << 20)	/* Dimensione delle pagine enormi se non ricavabile */
+
+/**
+	@brief Funzione che restituisce la dimensione delle pagine enormi
+
+	La ricava dalla riga Hugepagesize di /proc/meminfo.
+	@return Dimensione in byte delle pagine enormi
+ */
+static size_t dimensione_pagina_enorme(void){
+    char buffer[4096];
+    char* p;
+    int fd;
+    ssize_t letti;
+    
+    if((fd = open("/proc/meminfo", O_RDONLY)) == -1)
+        return PAGINA_ENORME_PREDEFINITA;
+    
+    letti = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    
+    if(letti <= 0)
+        return PAGINA_ENORME_PREDEFINITA;
+    
+    buffer[letti] = '\0';
+    
+    if((p = strstr(buffer, "Hugepagesize:")) == NULL)
+        return PAGINA_ENORME_PREDEFINITA;
+    
+    return (size_t) strtoul(p + 13, NULL, 10) * 1024;
+}
+
+/**
+	Arrotonda n byte a un multiplo della linea di cache.
+ */
+#define ALLINEA(n) (((n) + LINEA_CACHE - 1) / LINEA_CACHE * LINEA_CACHE)
+
+/**
+	@brief Procedura che calcola la posizione dei vettori nell'area
+
+	Il contatore occupa la prima linea di cache, ciascun vettore inizia a
+	una nuova linea di cache.
+	@param a Area di appoggio
+	@param n_risultati N° di risultati
+	@param n_cache N° di voci della cache dei risultati
+	@param tempi true se l'area contiene il vettore dei tempi
+ */
+static void posiziona_vettori(area_appoggio* a, int n_risultati, unsigned int n_cache, bool tempi){
+    char* p = (char *) a->indirizzo;
+    
+    a->n_risultati = n_risultati;
+    a->completati = (unsigned int *) p;
+    a->risultati = (res *) (p += LINEA_CACHE);
+    a->pronti = (unsigned int *) (p += ALLINEA(sizeof(res) * n_risultati));
+    a->tempi = tempi ? (long long *) (p + ALLINEA(sizeof(unsigned int) * n_risultati)) : NULL;
+    p += ALLINEA(sizeof(unsigned int) * n_risultati) + (tempi ? ALLINEA(sizeof(long long) * n_risultati) : 0);
+    cache_collega(&a->cache, n_cache > 0 ? (voce_cache *) p : NULL, n_cache);
+}
+
+/**
+	@brief Funzione che calcola la dimensione dell'area
+
+	@param n_risultati N° di risultati
+	@param n_cache N° di voci della cache dei risultati
+	@param tempi true se l'area contiene il vettore dei tempi
+	@return Dimensione in byte
+ */
+static size_t dimensione_area(int n_risultati, unsigned int n_cache, bool tempi){
+    return LINEA_CACHE + ALLINEA(sizeof(res) * n_risultati)
+           + ALLINEA(sizeof(unsigned int) * n_risultati) + (tempi ? ALLINEA(sizeof(long long) * n_risultati) : 0)
+           + ALLINEA(sizeof(voce_cache) * n_cache);
+}
+
+/**
+	@brief Funzione per la creazione dell'area di appoggio
+
+	Le pagine dell'area sono inizialmente a zero (contatore, indicatori pronti,
+	voci della cache vuote).
+	@param a Area da creare
+	@param n_risultati N° di risultati
+	@param n_cache N° di voci della cache dei risultati (potenza di 2, 0 se non attiva)
+	@param tempi true per allocare il vettore dei tempi
+	@param condivisa true per un segmento condiviso con i figli, false per memoria privata
+	@param pagine_enormi true per tentare l'allocazione su pagine enormi
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int appoggio_crea(area_appoggio* a, int n_risultati, unsigned int n_cache, bool tempi, bool condivisa, bool pagine_enormi){
+    size_t dimensione = dimensione_area(n_risultati, n_cache, tempi);
+    size_t enorme = dimensione_pagina_enorme();
+    size_t arrotondata = (dimensione + enorme - 1) / enorme * enorme;
+    
+    a->shmid = -1;
+    a->indirizzo = NULL;
+    
+    if(condivisa){
+        /**
+         Tento la creazione del segmento su pagine enormi (la dimensione deve
+         esserne un multiplo), altrimenti lo creo su pagine normali.
+         */
+        if(pagine_enormi && (a->shmid = shmget(IPC_PRIVATE, arrotondata, IPC_CREAT | SHM_HUGETLB | 0600)) != -1){
+            a->dimensione = arrotondata;
+            a->tipo = PAGINE_ENORMI;
+        } else if((a->shmid = shmget(IPC_PRIVATE, dimensione, IPC_CREAT | 0600)) != -1){
+            a->dimensione = dimensione;
+            a->tipo = PAGINE_NORMALI;
+        } else {
+            return -1;
+        }
+        
+        a->indirizzo = shmat(a->shmid, 0, 0);
+        
+        /**
+         Marco subito il segmento per la rimozione: resta in uso finchè
+         almeno un processo è collegato.
+         */
+        shmctl(a->shmid, IPC_RMID, NULL);
+        
+        if(a->indirizzo == (void *) -1){
+            a->indirizzo = NULL;
+            return -1;
+        }
+    } else {
+        if(pagine_enormi && (a->indirizzo = mmap(NULL, arrotondata, PROT_READ | PROT_WRITE,
+                                                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0)) != MAP_FAILED){
+            a->dimensione = arrotondata;
+            a->tipo = PAGINE_ENORMI;
+        } else if((a->indirizzo = mmap(NULL, dimensione, PROT_READ | PROT_WRITE,
+                                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) != MAP_FAILED){
+            a->dimensione = dimensione;
+            a->tipo = PAGINE_NORMALI;
+            
+            if(pagine_enormi && madvise(a->indirizzo, dimensione, MADV_HUGEPAGE) == 0)
+                a->tipo = PAGINE_TRASPARENTI;
+        } else {
+            a->indirizzo = NULL;
+            return -1;
+        }
+    }
+    
+    posiziona_vettori(a, n_risultati, n_cache, tempi);
+    
+    return 0;
+}
+
+/**
+	@brief Funzione per il collegamento di un figlio all'area di appoggio condivisa
+
+	@param a Area da collegare
+	@param shmid Id del segmento creato dal padre
+	@param n_risultati N° di risultati
+	@param n_cache N° di voci della cache dei risultati (0 se non attiva)
+	@param tempi true se l'area contiene il vettore dei tempi
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int appoggio_collega(area_appoggio* a, int shmid, int n_risultati, unsigned int n_cache, bool tempi){
+    a->shmid = shmid;
+    a->dimensione = dimensione_area(n_risultati, n_cache, tempi);
+    a->tipo = PAGINE_NORMALI;
+    
+    if((a->indirizzo = shmat(shmid, 0, 0)) == (void *) -1){
+        a->indirizzo = NULL;
+        return -1;
+    }
+    
+    posiziona_vettori(a, n_risultati, n_cache, tempi);
+    
+    return 0;
+}
+
+/**
+	@brief Funzione che descrive il tipo di memoria dell'area di appoggio
+
+	@param a Area di appoggio
+	@return Stringa descrittiva
+ */
+const char* appoggio_descrizione(const area_appoggio* a){
+    switch(a->tipo){
+        case PAGINE_ENORMI:
+            return "pagine enormi (hugetlb)";
+        case PAGINE_TRASPARENTI:
+            return "pagine normali (transparent huge pages richieste)";
+        default:
+            return "pagine normali";
+    }
+}
+
+/**
+	@brief Procedura di rilascio dell'area di appoggio
+ */
+void appoggio_rilascia(area_appoggio* a){
+    if(a->indirizzo == NULL)
+        return;
+    
+    if(a->shmid != -1)
+        shmdt(a->indirizzo);
+    else
+        munmap(a->indirizzo, a->dimensione);
+    
+    a->indirizzo = NULL;
+}
@@ -0,0 +1,130 @@
+/** @file appoggio.h
+
+	@brief Libreria per l'area di appoggio del vettore dei risultati.
+
+	L'area di appoggio è una zona di memoria, condivisa con i figli o privata
+	se i figli sono thread, che contiene il contatore delle operazioni
+	completate e il vettore dei risultati. Le operazioni restano nella
+	memoria privata del padre, che le copia nei canali dei figli.<br>
+	Ogni operazione porta il proprio n° di sequenza (indice): il figlio che
+	la esegue ne scrive il risultato direttamente nella posizione
+	indice % n_risultati del vettore dei risultati, senza passare dal padre.
+	Con l'opzione -S l'area contiene anche il vettore dei tempi, in cui il
+	padre salva l'istante di accodamento di ogni operazione e il figlio lo
+	sostituisce con la latenza dell'operazione (vedi statistiche.h).
+	Con l'opzione -C l'area contiene anche le voci della cache dei risultati
+	(vedi cache.h).<br>
+	Se il vettore contiene tutti i risultati (modalità normale) questi si
+	trovano nell'ordine dell'input; in modalità streaming il vettore è una
+	finestra circolare e il padre scrive i risultati in ordine man mano che
+	sono pronti, riconoscendoli dal vettore pronti.<br>
+	Su richiesta viene allocata su pagine enormi (SHM_HUGETLB o MAP_HUGETLB),
+	riducendo i TLB miss sui vettori di grandi dimensioni; se le pagine enormi
+	non sono disponibili si ripiega sulle pagine normali (chiedendo al kernel
+	le transparent huge pages per la memoria privata).<br>
+	Il segmento condiviso è creato con chiave IPC_PRIVATE e marcato subito per
+	la rimozione: i figli vi si collegano tramite il suo id e il sistema lo
+	rimuove quando l'ultimo processo se ne scollega, anche in caso di errore.
+ */
+
+#ifndef APPOGGIO_H
+#define APPOGGIO_H
+
+#include "functions.h"
+#include "cache.h"
+
+/**
+	Tipo di memoria su cui è allocata l'area di appoggio.
+ */
+typedef enum pagine {
+    PAGINE_NORMALI,		/**< Pagine normali */
+    PAGINE_TRASPARENTI,	/**< Pagine normali con transparent huge pages richieste (solo memoria privata) */
+    PAGINE_ENORMI		/**< Pagine enormi (hugetlb) */
+} pagine;
+
+/**
+	Area di appoggio contenente il contatore delle operazioni completate,
+	n_risultati risultati e i relativi indicatori ed eventualmente la cache
+	dei risultati.
+ */
+typedef struct area_appoggio {
+    void* indirizzo;			/**< Indirizzo dell'area nel processo */
+    size_t dimensione;			/**< Dimensione allocata in byte */
+    int shmid;					/**< Id del segmento condiviso, -1 se l'area è privata */
+    pagine tipo;				/**< Tipo di memoria usato */
+    int n_risultati;			/**< N° di risultati */
+    unsigned int* completati;	/**< N° di operazioni completate dai figli (su una linea di cache propria) */
+    res* risultati;				/**< Vettore dei risultati, indicizzato per n° di sequenza */
+    unsigned int* pronti;		/**< Per ogni risultato, n° di sequenza + 1 dell'ultima operazione salvata */
+    long long* tempi;			/**< Per ogni risultato, istante di accodamento e poi latenza (ns), NULL se non misurati */
+    cache_risultati cache;		/**< Cache dei risultati (cache.voci NULL se non attiva) */
+} area_appoggio;
+
+/**
+	@brief Funzione per la creazione dell'area di appoggio
+
+	@param a Area da creare
+	@param n_risultati N° di risultati
+	@param n_cache N° di voci della cache dei risultati (potenza di 2, 0 se non attiva)
+	@param tempi true per allocare il vettore dei tempi
+	@param condivisa true per un segmento condiviso con i figli, false per memoria privata
+	@param pagine_enormi true per tentare l'allocazione su pagine enormi
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int appoggio_crea(area_appoggio* a, int n_risultati, unsigned int n_cache, bool tempi, bool condivisa, bool pagine_enormi);
+
+/**
+	@brief Funzione per il collegamento di un figlio all'area di appoggio condivisa
+
+	@param a Area da collegare
+	@param shmid Id del segmento creato dal padre
+	@param n_risultati N° di risultati
+	@param n_cache N° di voci della cache dei risultati (0 se non attiva)
+	@param tempi true se l'area contiene il vettore dei tempi
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int appoggio_collega(area_appoggio* a, int shmid, int n_risultati, unsigned int n_cache, bool tempi);
+
+/**
+	@brief Procedura per il salvataggio del risultato di un'operazione eseguita
+
+	Scrive il risultato nella posizione data dal n° di sequenza dell'operazione
+	e la segnala come pronta. Non aggiorna il contatore delle completate.
+	@param a Area di appoggio
+	@param d Operazione eseguita
+ */
+static inline void appoggio_salva(area_appoggio* a, const dati* d){
+    unsigned int i = d->indice % a->n_risultati;
+    
+    a->risultati[i].n1 = d->num1;
+    a->risultati[i].op = d->op;
+    a->risultati[i].n2 = d->num2;
+    a->risultati[i].res = d->res;
+    __atomic_store_n(&a->pronti[i], d->indice + 1, __ATOMIC_RELEASE);
+}
+
+/**
+	@brief Funzione che verifica se il risultato di un'operazione è pronto
+
+	@param a Area di appoggio
+	@param indice N° di sequenza dell'operazione
+	@return true se il risultato è stato salvato
+ */
+static inline bool appoggio_pronto(const area_appoggio* a, unsigned int indice){
+    return __atomic_load_n(&a->pronti[indice % a->n_risultati], __ATOMIC_ACQUIRE) == indice + 1;
+}
+
+/**
+	@brief Funzione che descrive il tipo di memoria dell'area di appoggio
+
+	@param a Area di appoggio
+	@return Stringa descrittiva
+ */
+const char* appoggio_descrizione(const area_appoggio* a);
+
+/**
+	@brief Procedura di rilascio dell'area di appoggio
+ */
+void appoggio_rilascia(area_appoggio* a);
+
+#endif
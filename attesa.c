@@ -0,0 +1,161 @@
+/** @file attesa.c
+
+	@brief Libreria per le attese adattive di padre e figli.
+ */
+#define _GNU_SOURCE
+#include "attesa.h"
+#include "statistiche.h"
+
+#include <sched.h>
+
+/**
+	Politiche di attesa.
+ */
+typedef enum politica_attesa {
+    ATTESA_BLOCCA,		/* Blocco immediato */
+    ATTESA_ADATTIVA,	/* Attesa attiva proporzionale alla media delle attese */
+    ATTESA_FISSA		/* Attesa attiva di durata fissa */
+} politica_attesa;
+
+static politica_attesa politica = ATTESA_ADATTIVA;	/* Politica impostata */
+static long long fissa_ns = 0;						/* Durata dell'attesa attiva con ATTESA_FISSA (ns) */
+static bool una_cpu = false;						/* Flag: il processo può essere eseguito su una sola CPU */
+
+/**
+	Istruzione di attesa per i cicli di attesa attiva, che riduce consumo e
+	penalità di uscita dal ciclo.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define PAUSA() __builtin_ia32_pause()
+#else
+#define PAUSA() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/**
+	@brief Funzione di impostazione della politica di attesa
+
+	@param valore "blocca", "adattiva" o tempo di attesa attiva in microsecondi
+	@return 0 in caso di successo, -1 se la politica non è valida
+ */
+int attesa_imposta(const char* valore){
+    char* fine;
+    long microsecondi;
+    cpu_set_t cpu;
+    
+    if(sched_getaffinity(0, sizeof(cpu), &cpu) == 0)
+        una_cpu = CPU_COUNT(&cpu) == 1;
+    
+    if(strcmp(valore, "blocca") == 0){
+        politica = ATTESA_BLOCCA;
+        return 0;
+    }
+    
+    if(strcmp(valore, "adattiva") == 0){
+        politica = ATTESA_ADATTIVA;
+        return 0;
+    }
+    
+    microsecondi = strtol(valore, &fine, 10);
+    if(fine == valore || *fine != '\0' || microsecondi < 0)
+        return -1;
+    
+    politica = ATTESA_FISSA;
+    fissa_ns = microsecondi * 1000LL;
+    
+    return 0;
+}
+
+/**
+	@brief Funzione di inizializzazione della politica di attesa
+
+	Legge la politica dalla variabile d'ambiente ATTESA_ENV, se presente.
+	@return 0 in caso di successo, -1 se la politica non è valida
+ */
+int attesa_inizializza(void){
+    char* valore = getenv(ATTESA_ENV);
+    
+    return attesa_imposta(valore != NULL ? valore : "adattiva");
+}
+
+/**
+	@brief Funzione che restituisce la durata dell'attesa attiva di un richiedente
+ */
+static long long durata_attiva(const attesa* a){
+    switch(politica){
+        case ATTESA_FISSA:
+            return fissa_ns;
+        case ATTESA_ADATTIVA:
+            return una_cpu || a->media_ns >= ATTESA_MASSIMA_NS ? 0 : 2 * a->media_ns + 1000;
+        default:
+            return 0;
+    }
+}
+
+/**
+	@brief Procedura che aggiunge la durata di un'attesa alla media mobile (peso 1/8)
+ */
+static void registra(attesa* a, long long durata){
+    a->media_ns += (durata - a->media_ns) / 8;
+}
+
+/**
+	@brief Funzione di attesa attiva di una condizione
+
+	Attende attivamente, secondo la politica impostata, che pronto(arg)
+	restituisca true. Se la condizione non si avvera il chiamante deve
+	bloccarsi e, una volta risvegliato, chiamare attesa_termina().
+	@param a Stato delle attese del richiedente
+	@param pronto Funzione che verifica la condizione attesa
+	@param arg Argomento di pronto
+	@return true se la condizione si è avverata
+ */
+bool attesa_attiva(attesa* a, bool (*pronto)(const void*), const void* arg){
+    long long limite;
+    int i;
+    
+    if(politica == ATTESA_BLOCCA)
+        return false;
+    
+    a->inizio = statistiche_adesso();
+    limite = durata_attiva(a);
+    
+    /**
+     Ricontrollo la condizione con pause, leggendo l'orologio ogni 64 controlli.
+     */
+    for(i=1; limite > 0; i++){
+        if(pronto(arg)){
+            registra(a, statistiche_adesso() - a->inizio);
+            return true;
+        }
+    
+        if(i % 64 == 0 && statistiche_adesso() - a->inizio >= limite)
+            break;
+    
+        PAUSA();
+    }
+    
+    /**
+     Cedo la CPU, così che l'altra parte possa avanzare se condivide la CPU.
+     */
+    for(i=0; i<ATTESA_CESSIONI; i++){
+        sched_yield();
+    
+        if(pronto(arg)){
+            registra(a, statistiche_adesso() - a->inizio);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+/**
+	@brief Procedura di registrazione della fine di un'attesa conclusa con il blocco
+
+	Aggiorna la media delle durate delle attese con quella appena conclusa.
+	@param a Stato delle attese del richiedente
+ */
+void attesa_termina(attesa* a){
+    if(politica != ATTESA_BLOCCA)
+        registra(a, statistiche_adesso() - a->inizio);
+}
@@ -0,0 +1,77 @@
+/** @file attesa.h
+
+	@brief Libreria per le attese adattive di padre e figli.
+
+	Prima di bloccarsi su un semaforo (il figlio sul semaforo full quando non
+	ha operazioni, il padre sul semaforo empty quando un canale è pieno) padre
+	e figli attendono attivamente che la condizione attesa diventi vera:
+	ricontrollano la condizione con l'istruzione pause per un tempo limitato,
+	quindi cedono la CPU con sched_yield() per ATTESA_CESSIONI volte e solo
+	allora si bloccano. Quando le operazioni arrivano a raffica il passaggio
+	avviene così senza system call né risvegli.<br>
+	La politica è scelta con l'opzione -a di elab2 e passata ai figli con la
+	variabile d'ambiente ATTESA_ENV:<br>
+	- "blocca": nessuna attesa attiva, blocco immediato.<br>
+	- "adattiva" (default): il tempo di attesa attiva è il doppio della media
+	mobile delle durate delle attese precedenti dello stesso richiedente, se
+	questa è inferiore a ATTESA_MASSIMA_NS, altrimenti è nullo (le attese
+	lunghe non consumano CPU). Con una sola CPU disponibile l'attesa attiva
+	impedirebbe all'altra parte di avanzare ed è sempre nulla.<br>
+	- un numero: tempo fisso di attesa attiva in microsecondi.<br>
+ */
+
+#ifndef ATTESA_H
+#define ATTESA_H
+
+#include "functions.h"
+
+#define ATTESA_ENV "ELAB2_ATTESA"	/**< Variabile d'ambiente contenente la politica di attesa, ereditata dai figli */
+#define ATTESA_MASSIMA_NS 50000		/**< Media oltre la quale la politica adattiva non attende attivamente (ns) */
+#define ATTESA_CESSIONI 4			/**< N° di sched_yield() prima del blocco */
+
+/**
+	Stato delle attese di un richiedente (il figlio, o il padre verso un figlio).
+ */
+typedef struct attesa {
+    long long media_ns;		/**< Media mobile delle durate delle attese (ns) */
+    long long inizio;		/**< Istante di inizio dell'attesa in corso (ns) */
+} attesa;
+
+/**
+	@brief Funzione di inizializzazione della politica di attesa
+
+	Legge la politica dalla variabile d'ambiente ATTESA_ENV, se presente.
+	@return 0 in caso di successo, -1 se la politica non è valida
+ */
+int attesa_inizializza(void);
+
+/**
+	@brief Funzione di impostazione della politica di attesa
+
+	@param valore "blocca", "adattiva" o tempo di attesa attiva in microsecondi
+	@return 0 in caso di successo, -1 se la politica non è valida
+ */
+int attesa_imposta(const char* valore);
+
+/**
+	@brief Funzione di attesa attiva di una condizione
+
+	Attende attivamente, secondo la politica impostata, che pronto(arg)
+	restituisca true. Se la condizione non si avvera il chiamante deve
+	bloccarsi e, una volta risvegliato, chiamare attesa_termina().
+	@param a Stato delle attese del richiedente
+	@param pronto Funzione che verifica la condizione attesa
+	@param arg Argomento di pronto
+	@return true se la condizione si è avverata
+ */
+bool attesa_attiva(attesa* a, bool (*pronto)(const void*), const void* arg);
+
+/**
+	@brief Procedura di registrazione della fine di un'attesa conclusa con il blocco
+
+	Aggiorna la media delle durate delle attese con quella appena conclusa.
+	@param a Stato delle attese del richiedente
+ */
+void attesa_termina(attesa* a);
+
+#endif
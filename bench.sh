@@ -0,0 +1,61 @@
+#!/bin/sh
+# Banco di prova delle prestazioni di elab2 (eseguito da make bench).
+#
+# Genera con ./genera un file di configurazione sintetico ed esegue elab2 su
+# di esso in ciascuna modalità di MODALITA, RIPETIZIONI volte, con l'opzione
+# -S. Ogni esecuzione aggiunge a RISULTATI una riga JSON con la descrizione
+# del carico e della modalità, il tempo di avvio, il throughput e i
+# percentili della latenza per operazione (vedi statistiche.h).
+#
+# Parametri (variabili d'ambiente):
+#   OPERAZIONI   n° di operazioni del carico (default 1000000)
+#   FIGLI        n° di processi da simulare (default 4)
+#   OPERATORI    miscela degli operatori, vedi genera -m (default +-*/)
+#   ID0          percentuale di operazioni con id 0 (default 50)
+#   ASIMMETRIA   percentuale delle operazioni con id != 0 al figlio 1 (default 0)
+#   SEME         seme del generatore (default 1)
+#   RIPETIZIONI  n° di esecuzioni per modalità (default 3)
+#   MODALITA     opzioni di elab2 delle modalità da provare, separate da ';'
+#   RISULTATI    file a cui aggiungere le righe JSON (default bench.jsonl)
+
+OPERAZIONI=${OPERAZIONI:-1000000}
+FIGLI=${FIGLI:-4}
+OPERATORI=${OPERATORI:-+-*/}
+ID0=${ID0:-50}
+ASIMMETRIA=${ASIMMETRIA:-0}
+SEME=${SEME:-1}
+RIPETIZIONI=${RIPETIZIONI:-3}
+MODALITA=${MODALITA:--P;-T;-P -b 64;-T -b 64;-P -s;-T -s;-P -s -b 64;-T -s -b 64 -W}
+RISULTATI=${RISULTATI:-bench.jsonl}
+
+CARICO=bench_carico.txt
+MISURA=bench_misura.jsonl
+
+./genera -n "$OPERAZIONI" -w "$FIGLI" -m "$OPERATORI" -z "$ID0" -k "$ASIMMETRIA" -r "$SEME" -o "$CARICO" || exit 1
+
+DESCRIZIONE="\"carico\":{\"operazioni\":$OPERAZIONI,\"figli\":$FIGLI,\"operatori\":\"$OPERATORI\",\"id0\":$ID0,\"asimmetria\":$ASIMMETRIA,\"seme\":$SEME}"
+ESITO=0
+
+IFS=';'
+for OPZIONI in $MODALITA; do
+    unset IFS
+    r=1
+    while [ "$r" -le "$RIPETIZIONI" ]; do
+        rm -f "$MISURA"
+
+        # shellcheck disable=SC2086
+        if ./elab2 -l 0 -i "$CARICO" -o /dev/null $OPZIONI -S "$MISURA" > /dev/null && [ -s "$MISURA" ]; then
+            sed "s|^{|{$DESCRIZIONE,\"opzioni\":\"$OPZIONI\",\"ripetizione\":$r,|" "$MISURA" | tee -a "$RISULTATI"
+        else
+            echo "ERRORE: elab2 $OPZIONI terminato con errore" >&2
+            ESITO=1
+        fi
+
+        r=$((r + 1))
+    done
+    IFS=';'
+done
+unset IFS
+
+rm -f "$CARICO" "$MISURA"
+exit $ESITO
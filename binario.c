@@ -0,0 +1,94 @@
+/** @file binario.c
+
+	@brief Formati binari dei file di operazioni e di risultati.
+ */
+#include "binario.h"
+
+/**
+	@brief Funzione che verifica se un buffer inizia con un'intestazione binaria valida
+
+	@param buffer Inizio del file
+	@param n N° di byte disponibili nel buffer
+	@param magic Magic atteso (MAGIC_OPERAZIONI o MAGIC_RISULTATI)
+	@return true se il buffer inizia con un'intestazione del tipo indicato
+ */
+bool binario_riconosci(const void* buffer, size_t n, const char* magic){
+    const intestazione_binaria* h = (const intestazione_binaria *) buffer;
+    
+    return n >= sizeof(intestazione_binaria) && memcmp(h->magic, magic, 4) == 0 && h->versione == VERSIONE_BINARIO;
+}
+
+/**
+	@brief Funzione per la scrittura di un'intestazione binaria
+
+	@param fd File descriptor su cui scrivere
+	@param magic Magic del file (MAGIC_OPERAZIONI o MAGIC_RISULTATI)
+	@param valore N° di processi o di risultati
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int binario_scrivi_intestazione(int fd, const char* magic, int valore){
+    intestazione_binaria h;
+    
+    memcpy(h.magic, magic, 4);
+    h.versione = VERSIONE_BINARIO;
+    h.valore = valore;
+    h.riservato = 0;
+    
+    return scrivi_tutto(fd, &h, sizeof(h));
+}
+
+/**
+	@brief Procedura di conversione di un record di operazione in una struttura dati
+ */
+void binario_leggi_operazione(const record_operazione* r, dati* d){
+    d->id_sem = r->id;
+    d->num1 = r->num1;
+    d->op = r->op;
+    d->num2 = r->num2;
+    d->res_disponibile = false;
+}
+
+/**
+	@brief Procedura di conversione di una struttura dati in un record di operazione
+ */
+void binario_scrivi_operazione(const dati* d, record_operazione* r){
+    memset(r, 0, sizeof(*r));
+    r->id = d->id_sem;
+    r->num1 = d->num1;
+    r->num2 = d->num2;
+    r->op = d->op;
+}
+
+/**
+	@brief Procedura di conversione di un risultato in un record di risultato
+ */
+void binario_scrivi_risultato(const res* r, record_risultato* b){
+    memset(b, 0, sizeof(*b));
+    b->num1 = r->n1;
+    b->num2 = r->n2;
+    b->res = r->res;
+    b->op = r->op;
+}
+
+/**
+	@brief Funzione per la scrittura completa di un buffer
+
+	Ripete la write() finchè tutti i byte sono stati scritti.
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int scrivi_tutto(int fd, const void* buffer, size_t n){
+    const char* p = (const char *) buffer;
+    ssize_t scritti;
+    
+    while(n > 0){
+        if((scritti = write(fd, p, n)) == -1){
+            if(errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += scritti;
+        n -= scritti;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,111 @@
+/** @file binario.h
+
+	@brief Formati binari dei file di operazioni e di risultati.
+
+	In alternativa ai file di testo config.txt e res.txt, elab2 legge e
+	scrive file binari a record di lunghezza fissa, che non richiedono
+	analisi nè formattazione del testo.<br>
+	Entrambi i file iniziano con un'intestazione di 16 byte seguita da una
+	sequenza di record di 16 byte. Tutti i campi interi sono a 32 bit
+	nell'ordine dei byte della macchina (little-endian su x86).
+
+	<b>File di operazioni</b> (magic "IPCJ"): il campo valore dell'intestazione
+	contiene il n° di processi; ogni record contiene id, num1, num2, op.<br>
+	<b>File di risultati</b> (magic "IPCR"): il campo valore dell'intestazione
+	contiene il n° di risultati, o -1 se non noto alla creazione (streaming);
+	ogni record contiene num1, num2, res, op.
+
+	Il programma converti trasforma i file tra formato testo e binario.
+ */
+
+#ifndef BINARIO_H
+#define BINARIO_H
+
+#include "functions.h"
+
+#include <stdint.h>
+
+#define MAGIC_OPERAZIONI "IPCJ"	/**< Magic dei file di operazioni binari */
+#define MAGIC_RISULTATI "IPCR"	/**< Magic dei file di risultati binari */
+#define VERSIONE_BINARIO 1		/**< Versione corrente dei formati binari */
+
+/**
+	Intestazione dei file binari.
+ */
+typedef struct intestazione_binaria {
+    char magic[4];			/**< MAGIC_OPERAZIONI o MAGIC_RISULTATI */
+    uint32_t versione;		/**< VERSIONE_BINARIO */
+    int32_t valore;			/**< N° di processi (operazioni) o di risultati (-1 se non noto) */
+    uint32_t riservato;		/**< Riservato, 0 */
+} intestazione_binaria;
+
+/**
+	Record di un file di operazioni binario.
+ */
+typedef struct record_operazione {
+    int32_t id;				/**< Id del processo (0 = primo libero) */
+    int32_t num1;			/**< Primo operando */
+    int32_t num2;			/**< Secondo operando */
+    char op;				/**< Operatore */
+    char riservato[3];		/**< Riservato, 0 */
+} record_operazione;
+
+/**
+	Record di un file di risultati binario.
+ */
+typedef struct record_risultato {
+    int32_t num1;			/**< Primo operando */
+    int32_t num2;			/**< Secondo operando */
+    int32_t res;			/**< Risultato */
+    char op;				/**< Operatore */
+    char riservato[3];		/**< Riservato, 0 */
+} record_risultato;
+
+_Static_assert(sizeof(intestazione_binaria) == 16, "intestazione binaria di 16 byte");
+_Static_assert(sizeof(record_operazione) == 16, "record di operazione di 16 byte");
+_Static_assert(sizeof(record_risultato) == 16, "record di risultato di 16 byte");
+
+/**
+	@brief Funzione che verifica se un buffer inizia con un'intestazione binaria valida
+
+	@param buffer Inizio del file
+	@param n N° di byte disponibili nel buffer
+	@param magic Magic atteso (MAGIC_OPERAZIONI o MAGIC_RISULTATI)
+	@return true se il buffer inizia con un'intestazione del tipo indicato
+ */
+bool binario_riconosci(const void* buffer, size_t n, const char* magic);
+
+/**
+	@brief Funzione per la scrittura di un'intestazione binaria
+
+	@param fd File descriptor su cui scrivere
+	@param magic Magic del file (MAGIC_OPERAZIONI o MAGIC_RISULTATI)
+	@param valore N° di processi o di risultati
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int binario_scrivi_intestazione(int fd, const char* magic, int valore);
+
+/**
+	@brief Procedura di conversione di un record di operazione in una struttura dati
+ */
+void binario_leggi_operazione(const record_operazione* r, dati* d);
+
+/**
+	@brief Procedura di conversione di una struttura dati in un record di operazione
+ */
+void binario_scrivi_operazione(const dati* d, record_operazione* r);
+
+/**
+	@brief Procedura di conversione di un risultato in un record di risultato
+ */
+void binario_scrivi_risultato(const res* r, record_risultato* b);
+
+/**
+	@brief Funzione per la scrittura completa di un buffer
+
+	Ripete la write() finchè tutti i byte sono stati scritti.
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int scrivi_tutto(int fd, const void* buffer, size_t n);
+
+#endif
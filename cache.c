@@ -0,0 +1,159 @@
+/** @file cache.c
+
+	@brief Libreria per la cache dei risultati delle operazioni.
+ */
+#include "cache.h"
+
+#include <stdint.h>
+
+/**
+	@brief Funzione che calcola la posizione iniziale di una terna nella cache
+ */
+static unsigned int posizione(const cache_risultati* c, int num1, char op, int num2){
+    uint64_t h = (uint64_t) (uint32_t) num1 * 0x9E3779B97F4A7C15ULL;
+    
+    h ^= ((uint64_t) (uint32_t) num2 << 8 | (unsigned char) op) * 0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 29;
+    
+    return (unsigned int) h & c->maschera;
+}
+
+/**
+	@brief Funzione che restituisce il n° di voci della cache
+
+	@param richieste N° di voci richieste (al più CACHE_MASSIMA)
+	@return Potenza di 2 maggiore o uguale a richieste, 0 se richieste è 0
+ */
+unsigned int cache_voci(unsigned int richieste){
+    unsigned int n = 1;
+    
+    if(richieste == 0)
+        return 0;
+    
+    while(n < richieste)
+        n <<= 1;
+    
+    return n;
+}
+
+/**
+	@brief Procedura di collegamento della cache alle sue voci
+
+	Le voci devono essere inizialmente a zero (vuote).
+	@param c Cache da collegare
+	@param voci Vettore di n_voci voci, NULL se la cache non è attiva
+	@param n_voci N° di voci (potenza di 2)
+ */
+void cache_collega(cache_risultati* c, voce_cache* voci, unsigned int n_voci){
+    c->voci = voci;
+    c->maschera = n_voci - 1;
+    c->successi = 0;
+    c->fallimenti = 0;
+}
+
+/**
+	@brief Funzione di ricerca del risultato di un'operazione (padre)
+
+	Se la terna dell'operazione è nella cache ne salva il risultato nel
+	campo res e marca la voce come usata. Aggiorna i contatori di successi
+	e fallimenti.
+	@param c Cache
+	@param d Operazione da cercare
+	@return true se il risultato è stato trovato
+ */
+bool cache_cerca(cache_risultati* c, dati* d){
+    unsigned int p = posizione(c, d->num1, d->op, d->num2);
+    unsigned int versione, i;
+    voce_cache* v;
+    int res;
+    
+    for(i=0; i<CACHE_SONDAGGI; i++){
+        v = &c->voci[(p + i) & c->maschera];
+        versione = __atomic_load_n(&v->versione, __ATOMIC_ACQUIRE);
+    
+        if(versione == 0 || versione % 2 == 1)
+            continue;
+    
+        /**
+         Leggo la voce e la accetto solo se la versione non è cambiata nel frattempo.
+         */
+        if(__atomic_load_n(&v->num1, __ATOMIC_RELAXED) != d->num1 || __atomic_load_n(&v->op, __ATOMIC_RELAXED) != d->op
+           || __atomic_load_n(&v->num2, __ATOMIC_RELAXED) != d->num2)
+            continue;
+    
+        res = __atomic_load_n(&v->res, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    
+        if(__atomic_load_n(&v->versione, __ATOMIC_RELAXED) != versione)
+            continue;
+    
+        __atomic_store_n(&v->usata, true, __ATOMIC_RELAXED);
+        d->res = res;
+        c->successi++;
+    
+        return true;
+    }
+    
+    c->fallimenti++;
+    
+    return false;
+}
+
+/**
+	@brief Procedura di inserimento del risultato di un'operazione eseguita (figli)
+
+	Le operazioni con operatore sconosciuto non vengono inserite.
+	@param c Cache
+	@param d Operazione eseguita
+ */
+void cache_inserisci(cache_risultati* c, const dati* d){
+    unsigned int p = posizione(c, d->num1, d->op, d->num2);
+    unsigned int versione, i;
+    voce_cache* v;
+    voce_cache* scelta = NULL;
+    
+    if(d->op != '+' && d->op != '-' && d->op != '*' && d->op != '/')
+        return;
+    
+    /**
+     Cerco la terna o una voce vuota tra quelle possibili; altrimenti scelgo
+     la prima voce non usata, togliendo il marchio a quelle che scavalco.
+     */
+    for(i=0; i<CACHE_SONDAGGI; i++){
+        v = &c->voci[(p + i) & c->maschera];
+        versione = __atomic_load_n(&v->versione, __ATOMIC_ACQUIRE);
+    
+        if(versione == 0){
+            scelta = v;
+            break;
+        }
+    
+        if(versione % 2 == 0 && __atomic_load_n(&v->num1, __ATOMIC_RELAXED) == d->num1
+           && __atomic_load_n(&v->op, __ATOMIC_RELAXED) == d->op && __atomic_load_n(&v->num2, __ATOMIC_RELAXED) == d->num2)
+            return;
+    
+        if(scelta == NULL && !__atomic_exchange_n(&v->usata, false, __ATOMIC_RELAXED))
+            scelta = v;
+    }
+    
+    /**
+     Se tutte le voci erano usate sostituisco quella iniziale.
+     */
+    if(scelta == NULL)
+        scelta = &c->voci[p];
+    
+    /**
+     Blocco la voce rendendone dispari la versione; se un altro figlio la
+     sta scrivendo rinuncio.
+     */
+    versione = __atomic_load_n(&scelta->versione, __ATOMIC_RELAXED);
+    if(versione % 2 == 1 || !__atomic_compare_exchange_n(&scelta->versione, &versione, versione + 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return;
+    
+    __atomic_store_n(&scelta->num1, d->num1, __ATOMIC_RELAXED);
+    __atomic_store_n(&scelta->op, d->op, __ATOMIC_RELAXED);
+    __atomic_store_n(&scelta->num2, d->num2, __ATOMIC_RELAXED);
+    __atomic_store_n(&scelta->res, d->res, __ATOMIC_RELAXED);
+    __atomic_store_n(&scelta->usata, false, __ATOMIC_RELAXED);
+    __atomic_store_n(&scelta->versione, versione + 2, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,91 @@
+/** @file cache.h
+
+	@brief Libreria per la cache dei risultati delle operazioni.
+
+	Con l'opzione -C di elab2 l'area di appoggio contiene una tabella hash a
+	indirizzamento aperto di dimensione fissa (potenza di 2) che associa a
+	ogni terna (num1, op, num2) già calcolata il suo risultato.<br>
+	I figli vi inseriscono i risultati delle operazioni eseguite; il padre la
+	consulta prima di inviare ogni operazione e, se vi trova il risultato,
+	lo salva direttamente nell'area di appoggio senza passare da un figlio.<br>
+	Una terna può trovarsi solo in una delle CACHE_SONDAGGI voci che seguono
+	la posizione data dal suo hash. Se sono tutte occupate viene sostituita
+	la prima voce non usata dall'ultimo passaggio (algoritmo dell'orologio):
+	il padre marca come usata ogni voce trovata e l'inserimento toglie il
+	marchio alle voci che scavalca.<br>
+	Ogni voce è protetta da un contatore di versione (seqlock), dispari
+	durante la scrittura: un figlio che trova la voce occupata da un altro
+	rinuncia all'inserimento e il padre scarta le voci lette durante una
+	scrittura, così che non servano lock nè attese.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "functions.h"
+
+#define CACHE_SONDAGGI 8			/**< N° di voci in cui può trovarsi una terna */
+#define CACHE_MASSIMA (1 << 24)	/**< N° massimo di voci della cache */
+
+/**
+	Voce della cache, nella memoria condivisa.
+ */
+typedef struct voce_cache {
+    unsigned int versione;	/**< Contatore di versione: 0 voce vuota, dispari durante la scrittura */
+    int num1;				/**< Primo operando */
+    int num2;				/**< Secondo operando */
+    int res;				/**< Risultato */
+    char op;				/**< Operatore */
+    bool usata;				/**< Flag: voce trovata dal padre dall'ultimo passaggio dell'orologio */
+} voce_cache;
+
+/**
+	Cache dei risultati collegata da un processo.
+ */
+typedef struct cache_risultati {
+    voce_cache* voci;					/**< Voci della cache, NULL se la cache non è attiva */
+    unsigned int maschera;				/**< N° di voci - 1 */
+    unsigned long long successi;		/**< N° di operazioni trovate nella cache (solo padre) */
+    unsigned long long fallimenti;		/**< N° di operazioni non trovate nella cache (solo padre) */
+} cache_risultati;
+
+/**
+	@brief Funzione che restituisce il n° di voci della cache
+
+	@param richieste N° di voci richieste (al più CACHE_MASSIMA)
+	@return Potenza di 2 maggiore o uguale a richieste, 0 se richieste è 0
+ */
+unsigned int cache_voci(unsigned int richieste);
+
+/**
+	@brief Procedura di collegamento della cache alle sue voci
+
+	Le voci devono essere inizialmente a zero (vuote).
+	@param c Cache da collegare
+	@param voci Vettore di n_voci voci, NULL se la cache non è attiva
+	@param n_voci N° di voci (potenza di 2)
+ */
+void cache_collega(cache_risultati* c, voce_cache* voci, unsigned int n_voci);
+
+/**
+	@brief Funzione di ricerca del risultato di un'operazione (padre)
+
+	Se la terna dell'operazione è nella cache ne salva il risultato nel
+	campo res e marca la voce come usata. Aggiorna i contatori di successi
+	e fallimenti.
+	@param c Cache
+	@param d Operazione da cercare
+	@return true se il risultato è stato trovato
+ */
+bool cache_cerca(cache_risultati* c, dati* d);
+
+/**
+	@brief Procedura di inserimento del risultato di un'operazione eseguita (figli)
+
+	Le operazioni con operatore sconosciuto non vengono inserite.
+	@param c Cache
+	@param d Operazione eseguita
+ */
+void cache_inserisci(cache_risultati* c, const dati* d);
+
+#endif
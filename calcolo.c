@@ -0,0 +1,304 @@
+/** @file calcolo.c
+
+	@brief Libreria per l'esecuzione dei calcoli a lotti.
+ */
+#include "calcolo.h"
+
+#include <limits.h>
+#include <immintrin.h>
+
+/**
+	Kernel che calcola r[i] = a[i] op b[i] per i in [0, n).
+ */
+typedef void (*kernel_calcolo)(const int* a, const int* b, int* r, int n);
+
+/**
+	Insieme dei kernel relativi a un'estensione vettoriale.
+ */
+typedef struct kernel {
+    const char* nome;				/* Nome dell'estensione */
+    kernel_calcolo somma;			/* Kernel per l'operatore + */
+    kernel_calcolo differenza;		/* Kernel per l'operatore - */
+    kernel_calcolo prodotto;		/* Kernel per l'operatore * */
+    kernel_calcolo quoziente;		/* Kernel per l'operatore / (divisori non nulli) */
+} kernel;
+
+static const kernel* selezionato = NULL;	/* Kernel scelto da calcolo_inizializza() */
+
+/* ------------------------------------------------------------------ */
+/* Kernel scalari                                                      */
+/* ------------------------------------------------------------------ */
+
+static void somma_scalare(const int* a, const int* b, int* r, int n){
+    int i;
+    for(i=0; i<n; i++)
+        r[i] = (int) ((unsigned int) a[i] + (unsigned int) b[i]);
+}
+
+static void differenza_scalare(const int* a, const int* b, int* r, int n){
+    int i;
+    for(i=0; i<n; i++)
+        r[i] = (int) ((unsigned int) a[i] - (unsigned int) b[i]);
+}
+
+static void prodotto_scalare(const int* a, const int* b, int* r, int n){
+    int i;
+    for(i=0; i<n; i++)
+        r[i] = (int) ((unsigned int) a[i] * (unsigned int) b[i]);
+}
+
+static void quoziente_scalare(const int* a, const int* b, int* r, int n){
+    int i;
+    for(i=0; i<n; i++)
+        r[i] = a[i] / b[i];
+}
+
+static const kernel kernel_scalare = {
+    "scalare", somma_scalare, differenza_scalare, prodotto_scalare, quoziente_scalare
+};
+
+/* ------------------------------------------------------------------ */
+/* Kernel SSE4.1 (4 interi per istruzione)                             */
+/* ------------------------------------------------------------------ */
+
+__attribute__((target("sse4.1")))
+static void somma_sse(const int* a, const int* b, int* r, int n){
+    int i;
+    for(i=0; i+4<=n; i+=4)
+        _mm_storeu_si128((__m128i *) (r+i), _mm_add_epi32(_mm_loadu_si128((const __m128i *) (a+i)), _mm_loadu_si128((const __m128i *) (b+i))));
+    somma_scalare(a+i, b+i, r+i, n-i);
+}
+
+__attribute__((target("sse4.1")))
+static void differenza_sse(const int* a, const int* b, int* r, int n){
+    int i;
+    for(i=0; i+4<=n; i+=4)
+        _mm_storeu_si128((__m128i *) (r+i), _mm_sub_epi32(_mm_loadu_si128((const __m128i *) (a+i)), _mm_loadu_si128((const __m128i *) (b+i))));
+    differenza_scalare(a+i, b+i, r+i, n-i);
+}
+
+__attribute__((target("sse4.1")))
+static void prodotto_sse(const int* a, const int* b, int* r, int n){
+    int i;
+    for(i=0; i+4<=n; i+=4)
+        _mm_storeu_si128((__m128i *) (r+i), _mm_mullo_epi32(_mm_loadu_si128((const __m128i *) (a+i)), _mm_loadu_si128((const __m128i *) (b+i))));
+    prodotto_scalare(a+i, b+i, r+i, n-i);
+}
+
+/**
+	La divisione intera a 32 bit è calcolata in doppia precisione: il quoziente
+	esatto troncato coincide con quello intero perchè |a|,|b| < 2^31.
+ */
+__attribute__((target("sse4.1")))
+static void quoziente_sse(const int* a, const int* b, int* r, int n){
+    int i;
+    __m128d q;
+    for(i=0; i+2<=n; i+=2){
+        q = _mm_div_pd(_mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *) (a+i))),
+                       _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *) (b+i))));
+        _mm_storel_epi64((__m128i *) (r+i), _mm_cvttpd_epi32(q));
+    }
+    quoziente_scalare(a+i, b+i, r+i, n-i);
+}
+
+static const kernel kernel_sse = {
+    "sse4.1", somma_sse, differenza_sse, prodotto_sse, quoziente_sse
+};
+
+/* ------------------------------------------------------------------ */
+/* Kernel AVX2 (8 interi per istruzione)                               */
+/* ------------------------------------------------------------------ */
+
+__attribute__((target("avx2")))
+static void somma_avx2(const int* a, const int* b, int* r, int n){
+    int i;
+    for(i=0; i+8<=n; i+=8)
+        _mm256_storeu_si256((__m256i *) (r+i), _mm256_add_epi32(_mm256_loadu_si256((const __m256i *) (a+i)), _mm256_loadu_si256((const __m256i *) (b+i))));
+    somma_scalare(a+i, b+i, r+i, n-i);
+}
+
+__attribute__((target("avx2")))
+static void differenza_avx2(const int* a, const int* b, int* r, int n){
+    int i;
+    for(i=0; i+8<=n; i+=8)
+        _mm256_storeu_si256((__m256i *) (r+i), _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (a+i)), _mm256_loadu_si256((const __m256i *) (b+i))));
+    differenza_scalare(a+i, b+i, r+i, n-i);
+}
+
+__attribute__((target("avx2")))
+static void prodotto_avx2(const int* a, const int* b, int* r, int n){
+    int i;
+    for(i=0; i+8<=n; i+=8)
+        _mm256_storeu_si256((__m256i *) (r+i), _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *) (a+i)), _mm256_loadu_si256((const __m256i *) (b+i))));
+    prodotto_scalare(a+i, b+i, r+i, n-i);
+}
+
+/**
+	Divisione a blocchi di 4 in doppia precisione.<br>
+	Se i 4 divisori del blocco sono uguali (caso frequente nei lotti di
+	operazioni ripetute) la divisione è sostituita dal prodotto per il
+	reciproco, calcolato una sola volta per ogni divisore distinto.
+	Il prodotto può sottostimare di 1 in modulo solo i quozienti esatti,
+	per cui il risultato viene corretto verificando (q + segno) * b == a.
+ */
+__attribute__((target("avx2")))
+static void quoziente_avx2(const int* a, const int* b, int* r, int n){
+    int i;
+    int divisore = 0;						/* Divisore di cui è noto il reciproco */
+    __m256d reciproco = _mm256_setzero_pd();
+    __m256d na, nb, q, segno, corretto;
+    __m128i vb;
+
+    for(i=0; i+4<=n; i+=4){
+        vb = _mm_loadu_si128((const __m128i *) (b+i));
+        na = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *) (a+i)));
+        nb = _mm256_cvtepi32_pd(vb);
+
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(vb, _mm_set1_epi32(b[i]))) == 0xFFFF){
+            if(b[i] != divisore){
+                divisore = b[i];
+                reciproco = _mm256_set1_pd(1.0 / divisore);
+            }
+            q = _mm256_round_pd(_mm256_mul_pd(na, reciproco), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+
+            /* segno = +1 se a/b > 0, -1 se a/b < 0 */
+            segno = _mm256_or_pd(_mm256_and_pd(_mm256_xor_pd(na, nb), _mm256_set1_pd(-0.0)), _mm256_set1_pd(1.0));
+            corretto = _mm256_add_pd(q, segno);
+            q = _mm256_blendv_pd(q, corretto, _mm256_cmp_pd(_mm256_mul_pd(corretto, nb), na, _CMP_EQ_OQ));
+        } else {
+            q = _mm256_div_pd(na, nb);
+        }
+
+        _mm_storeu_si128((__m128i *) (r+i), _mm256_cvttpd_epi32(q));
+    }
+    quoziente_scalare(a+i, b+i, r+i, n-i);
+}
+
+static const kernel kernel_avx2 = {
+    "avx2", somma_avx2, differenza_avx2, prodotto_avx2, quoziente_avx2
+};
+
+/* ------------------------------------------------------------------ */
+
+/**
+	@brief Procedura di selezione del kernel di calcolo
+
+	Rileva le estensioni vettoriali supportate dalla CPU e sceglie il kernel
+	più veloce disponibile. È chiamata automaticamente al primo calcolo.
+ */
+void calcolo_inizializza(void){
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx2"))
+        selezionato = &kernel_avx2;
+    else if(__builtin_cpu_supports("sse4.1"))
+        selezionato = &kernel_sse;
+    else
+        selezionato = &kernel_scalare;
+}
+
+/**
+	@brief Funzione che restituisce il nome del kernel di calcolo selezionato
+
+	@return "avx2", "sse4.1" o "scalare"
+ */
+const char* calcolo_kernel(void){
+    if(selezionato == NULL)
+        calcolo_inizializza();
+
+    return selezionato->nome;
+}
+
+/**
+	Operandi delle operazioni di un lotto con lo stesso operatore, in formato
+	structure-of-arrays, e posizione di ciascuna nel lotto originale.
+ */
+typedef struct gruppo {
+    int n;							/* N° di operazioni nel gruppo */
+    int a[CALCOLO_BLOCCO];			/* Primi operandi */
+    int b[CALCOLO_BLOCCO];			/* Secondi operandi */
+    int r[CALCOLO_BLOCCO];			/* Risultati */
+    int pos[CALCOLO_BLOCCO];		/* Indici delle operazioni nel lotto */
+} gruppo;
+
+/**
+	@brief Procedura che calcola un gruppo con il kernel indicato e salva i risultati nel lotto
+ */
+static void calcola_gruppo(gruppo* g, kernel_calcolo k, dati* ops){
+    int i;
+
+    if(g->n == 0)
+        return;
+
+    k(g->a, g->b, g->r, g->n);
+
+    for(i=0; i<g->n; i++)
+        ops[g->pos[i]].res = g->r[i];
+
+    g->n = 0;
+}
+
+/**
+	@brief Procedura per l'esecuzione di un lotto di operazioni
+
+	Calcola il risultato di ciascuna operazione del vettore ops e lo salva
+	nel campo res. Le operazioni con operatore sconosciuto non vengono modificate.<br>
+	Somme, differenze e prodotti seguono l'aritmetica modulo 2^32; la divisione
+	per 0 restituisce 0 e INT_MIN / -1 restituisce INT_MIN.
+	@param ops Vettore di operazioni
+	@param n N° di operazioni nel vettore
+ */
+void calcola_operazioni(dati* ops, int n){
+    gruppo gruppi[4];		/* Gruppi per + - * / */
+    gruppo* g;
+    int i, j;
+
+    if(selezionato == NULL)
+        calcolo_inizializza();
+
+    for(j=0; j<4; j++)
+        gruppi[j].n = 0;
+
+    for(i=0; i<n; i+=CALCOLO_BLOCCO){
+        /**
+         Raggruppo per operatore le operazioni del blocco corrente.
+         */
+        for(j=i; j<n && j<i+CALCOLO_BLOCCO; j++){
+            switch(ops[j].op){
+                case '+': g = &gruppi[0]; break;
+                case '-': g = &gruppi[1]; break;
+                case '*': g = &gruppi[2]; break;
+                case '/':
+                    /**
+                     I casi non rappresentabili della divisione sono risolti qui,
+                     così che i kernel ricevano solo divisori validi.
+                     */
+                    if(ops[j].num2 == 0){
+                        ops[j].res = 0;
+                        continue;
+                    }
+                    if(ops[j].num2 == -1 && ops[j].num1 == INT_MIN){
+                        ops[j].res = INT_MIN;
+                        continue;
+                    }
+                    g = &gruppi[3];
+                    break;
+                default:
+                    continue;
+            }
+
+            g->a[g->n] = ops[j].num1;
+            g->b[g->n] = ops[j].num2;
+            g->pos[g->n] = j;
+            g->n++;
+        }
+
+        /**
+         Calcolo ciascun gruppo con il kernel vettoriale corrispondente.
+         */
+        calcola_gruppo(&gruppi[0], selezionato->somma, ops);
+        calcola_gruppo(&gruppi[1], selezionato->differenza, ops);
+        calcola_gruppo(&gruppi[2], selezionato->prodotto, ops);
+        calcola_gruppo(&gruppi[3], selezionato->quoziente, ops);
+    }
+}
@@ -0,0 +1,45 @@
+/** @file calcolo.h
+
+	@brief Libreria per l'esecuzione dei calcoli a lotti.
+
+	Contiene le definizioni del kernel di calcolo usato dai processi figli:
+	le operazioni di un lotto vengono raggruppate per operatore in vettori
+	separati di operandi (structure-of-arrays) e calcolate con istruzioni
+	AVX2 o SSE4.1, scelte a runtime in base alla CPU, o in versione scalare.
+ */
+
+#ifndef CALCOLO_H
+#define CALCOLO_H
+
+#include "functions.h"
+
+#define CALCOLO_BLOCCO 256	/**< N° massimo di operazioni raggruppate per operatore in un passo */
+
+/**
+	@brief Procedura di selezione del kernel di calcolo
+
+	Rileva le estensioni vettoriali supportate dalla CPU e sceglie il kernel
+	più veloce disponibile. È chiamata automaticamente al primo calcolo.
+ */
+void calcolo_inizializza(void);
+
+/**
+	@brief Funzione che restituisce il nome del kernel di calcolo selezionato
+
+	@return "avx2", "sse4.1" o "scalare"
+ */
+const char* calcolo_kernel(void);
+
+/**
+	@brief Procedura per l'esecuzione di un lotto di operazioni
+
+	Calcola il risultato di ciascuna operazione del vettore ops e lo salva
+	nel campo res. Le operazioni con operatore sconosciuto non vengono modificate.<br>
+	Somme, differenze e prodotti seguono l'aritmetica modulo 2^32; la divisione
+	per 0 restituisce 0 e INT_MIN / -1 restituisce INT_MIN.
+	@param ops Vettore di operazioni
+	@param n N° di operazioni nel vettore
+ */
+void calcola_operazioni(dati* ops, int n);
+
+#endif
@@ -0,0 +1,173 @@
+/** @file converti.c
+
+	@brief Programma di conversione tra i formati testo e binario.
+
+	Uso:<br>
+	- converti -j operazioni.txt operazioni.bin: operazioni da testo a binario<br>
+	- converti -t operazioni.bin operazioni.txt: operazioni da binario a testo<br>
+	- converti -r risultati.bin risultati.txt: risultati da binario a testo<br>
+	- converti -R risultati.txt risultati.bin: risultati da testo a binario<br>
+
+	I formati binari sono descritti in binario.h.
+ */
+#include "functions.h"
+#include "parser.h"
+#include "binario.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define DIMENSIONE_USCITA (1 << 20)	/**< Dimensione del buffer di scrittura */
+
+char uscita[DIMENSIONE_USCITA];		/**< Buffer di scrittura */
+int n_uscita = 0;					/**< N° di byte presenti nel buffer di scrittura */
+int fd_uscita;						/**< File descriptor del file di destinazione */
+
+/**
+	@brief Procedura che accoda n byte al buffer di scrittura, svuotandolo se pieno
+ */
+static void accoda(const void* buffer, int n){
+    if(n_uscita + n > DIMENSIONE_USCITA){
+        if(scrivi_tutto(fd_uscita, uscita, n_uscita) == -1){
+            my_write(1, "ERRORE: Scrittura file di destinazione\n");
+            exit(1);
+        }
+        n_uscita = 0;
+    }
+    
+    memcpy(uscita + n_uscita, buffer, n);
+    n_uscita += n;
+}
+
+/**
+	@brief Procedura di conversione di un file di operazioni (testo o binario)
+	nel formato indicato
+ */
+static void converti_operazioni(const char* sorgente, bool verso_binario){
+    lavoro job;
+    record_operazione record;
+    char linea[64];
+    int i;
+    
+    if(carica_file(sorgente, &job) == -1)
+        exit(1);
+    
+    if(job.riferimenti != NULL){
+        snprintf(sprintf_buffer, sizeof(sprintf_buffer), "ERRORE: %s: gli operandi $k non sono rappresentabili nel formato binario\n", sorgente);
+        my_write(1, sprintf_buffer);
+        exit(1);
+    }
+    
+    if(verso_binario){
+        binario_scrivi_intestazione(fd_uscita, MAGIC_OPERAZIONI, job.numero_processi);
+        for(i=0; i<job.n_operazioni; i++){
+            binario_scrivi_operazione(&job.operazioni[i], &record);
+            accoda(&record, sizeof(record));
+        }
+    } else {
+        accoda(linea, sprintf(linea, "%d\n", job.numero_processi));
+        for(i=0; i<job.n_operazioni; i++)
+            accoda(linea, sprintf(linea, "%d %d %c %d\n", job.operazioni[i].id_sem, job.operazioni[i].num1, job.operazioni[i].op, job.operazioni[i].num2));
+    }
+}
+
+/**
+	@brief Procedura di conversione di un file di risultati binario in testo
+ */
+static void risultati_in_testo(const char* sorgente){
+    int fd, i, n;
+    struct stat st;
+    const char* testo;
+    const record_risultato* r;
+    char linea[80];
+    
+    if((fd = open(sorgente, O_RDONLY)) == -1 || fstat(fd, &st) == -1
+       || (testo = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED){
+        sprintf(sprintf_buffer, "ERRORE: Apertura file %s\n", sorgente);
+        my_write(1, sprintf_buffer);
+        exit(1);
+    }
+    
+    if(!binario_riconosci(testo, st.st_size, MAGIC_RISULTATI)){
+        sprintf(sprintf_buffer, "ERRORE: %s non è un file di risultati binario\n", sorgente);
+        my_write(1, sprintf_buffer);
+        exit(1);
+    }
+    
+    n = (st.st_size - sizeof(intestazione_binaria)) / sizeof(record_risultato);
+    r = (const record_risultato *) (testo + sizeof(intestazione_binaria));
+    
+    accoda("*************************\n*      RISULTATI        *\n*************************\n", 78);
+    for(i=0; i<n; i++)
+        accoda(linea, sprintf(linea, "%d. %d %c %d = %d\n", i+1, r[i].num1, r[i].op, r[i].num2, r[i].res));
+    
+    munmap((void *) testo, st.st_size);
+    close(fd);
+}
+
+/**
+	@brief Procedura di conversione di un file di risultati testuale (res.txt) in binario
+ */
+static void risultati_in_binario(const char* sorgente){
+    FILE* f;
+    char linea[256];
+    int n = 0, indice;
+    record_risultato record;
+    
+    if((f = fopen(sorgente, "r")) == NULL){
+        sprintf(sprintf_buffer, "ERRORE: Apertura file %s\n", sorgente);
+        my_write(1, sprintf_buffer);
+        exit(1);
+    }
+    
+    /**
+     Il n° di risultati è noto solo alla fine: l'intestazione viene
+     riscritta dopo la conversione.
+     */
+    binario_scrivi_intestazione(fd_uscita, MAGIC_RISULTATI, -1);
+    
+    while(fgets(linea, sizeof(linea), f) != NULL){
+        memset(&record, 0, sizeof(record));
+        if(sscanf(linea, "%d. %d %c %d = %d", &indice, &record.num1, &record.op, &record.num2, &record.res) == 5){
+            accoda(&record, sizeof(record));
+            n++;
+        }
+    }
+    fclose(f);
+    
+    scrivi_tutto(fd_uscita, uscita, n_uscita);
+    n_uscita = 0;
+    
+    if(lseek(fd_uscita, 0, SEEK_SET) == 0)
+        binario_scrivi_intestazione(fd_uscita, MAGIC_RISULTATI, n);
+}
+
+int main(int argc, char *argv[]){
+    if(argc != 4 || argv[1][0] != '-' || strchr("jtrR", argv[1][1]) == NULL || argv[1][2] != '\0'){
+        my_write(1, "Uso: converti -j|-t|-r|-R sorgente destinazione\n");
+        my_write(1, "  -j operazioni testo -> binario\n  -t operazioni binario -> testo\n");
+        my_write(1, "  -r risultati binario -> testo\n  -R risultati testo -> binario\n");
+        exit(1);
+    }
+    
+    if((fd_uscita = creat(argv[3], 0666)) == -1){
+        sprintf(sprintf_buffer, "ERRORE: Creazione file %s\n", argv[3]);
+        my_write(1, sprintf_buffer);
+        exit(1);
+    }
+    
+    switch(argv[1][1]){
+        case 'j': converti_operazioni(argv[2], true); break;
+        case 't': converti_operazioni(argv[2], false); break;
+        case 'r': risultati_in_testo(argv[2]); break;
+        case 'R': risultati_in_binario(argv[2]); break;
+    }
+    
+    if(scrivi_tutto(fd_uscita, uscita, n_uscita) == -1){
+        my_write(1, "ERRORE: Scrittura file di destinazione\n");
+        exit(1);
+    }
+    
+    close(fd_uscita);
+    exit(0);
+}
@@ -3,142 +3,1175 @@
  @brief Programma che utilizzando le system call (IPC) implementa un simulatore di
  calcolo parallelo.
  
+ Uso: elab2 [-b dimensione_lotto] [-i input] [-o output] [-s] [-B] [-W] [-l livello] [-T|-P] [-c cpu] [-H] [-S statistiche] [-a attesa] [-D figli] [-C voci]<br>
+ - -b: n° di operazioni (1-CAPACITA_CANALE, default 1) accodate a un figlio
+ prima di segnalargliele con un'unica operazione di sincronizzazione.<br>
+ - -i: file di configurazione da leggere (default config.txt, "-" per lo
+ standard input).<br>
+ - -o: file su cui scrivere i risultati (default res.txt, "-" per lo standard output).<br>
+ - -s: modalità streaming: le operazioni vengono lette, eseguite e i risultati
+ scritti man mano, con memoria costante. È attivata automaticamente se l'input
+ non è un file regolare (pipe, FIFO, standard input).<br>
+ - -B: scrive i risultati nel formato binario descritto in binario.h.
+ Il formato dell'input (testo o binario) è riconosciuto automaticamente.<br>
+ - -W: le scritture sul file di output vengono eseguite da un thread dedicato,
+ in parallelo alla formattazione dei risultati e ai calcoli.<br>
+ - -l: livello dei messaggi stampati a video da padre e figli: 0 solo errori,
+ 1 fasi della simulazione (default), 2 anche un messaggio per ogni operazione.
+ Il default può essere impostato con la variabile d'ambiente ELAB2_LOG; se
+ compilato con make LOG=no i messaggi per operazione non sono disponibili.<br>
+ - -T: i figli sono thread del processo elab2 che eseguono la routine di
+ lavoratore.c sui canali in memoria privata, senza creazione di processi
+ né memoria condivisa.<br>
+ - -P: i figli sono processi separati che eseguono ./routine (default, se non
+ compilato con make MOTORE=thread).<br>
+ - -c: fissa il figlio id alla id-esima CPU (ciclicamente) della lista indicata
+ (es. "0-3,8") e ne sposta il canale sul nodo NUMA della CPU; con "auto" la
+ lista è ricavata dalla topologia della macchina (vedi affinita.h).<br>
+ - -H: alloca l'area di appoggio dei vettori di operazioni e risultati su
+ pagine enormi, se disponibili (vedi appoggio.h).<br>
+ - -S: misura tempo di avvio, throughput e latenza delle operazioni e aggiunge
+ i risultati come riga JSON al file indicato ("-" per lo standard error,
+ vedi statistiche.h).<br>
+ - -a: politica di attesa di padre e figli prima di bloccarsi su un semaforo:
+ "blocca", "adattiva" (default) o tempo fisso di attesa attiva in
+ microsecondi. Il default può essere impostato con la variabile d'ambiente
+ ELAB2_ATTESA (vedi attesa.h).<br>
+ - -D: modalità demone: crea i figli indicati e li mantiene collegati e
+ inattivi tra un lavoro e l'altro, eseguendo i lavori inviati dai clienti
+ (programma invia) attraverso lo sportello in memoria condivisa (vedi
+ sportello.h), finchè un cliente non ne richiede la terminazione.
+ Le opzioni -i, -o, -s e -B sono ignorate.<br>
+ - -C: cache dei risultati con il n° di voci indicato (arrotondato a una
+ potenza di 2, al più CACHE_MASSIMA): prima di inviare un'operazione il padre
+ cerca la terna (num1, op, num2) tra quelle già calcolate dai figli e, se la
+ trova, ne salva direttamente il risultato (vedi cache.h). In modalità demone
+ la cache è condivisa tra i lavori.<br>
+ 
  Il programma dovrà leggere un file di configurazione contenente:<br>
  - N° di processi di calcolo parallelo<br>
  - Dati di computazione (formato id num1 op num2)<br>
+ Un operando può essere "$k", il risultato della k-esima operazione del file
+ (vedi parser.h): l'operazione viene inviata solo quando i risultati a cui fa
+ riferimento sono pronti, mentre le operazioni indipendenti proseguono.
+ I riferimenti non sono ammessi in modalità streaming nè in modalità demone.<br>
  
  Il processo padre eseguirà nel seguente modo:<br>
  - Setup della simulazione leggendo dal file di configurazione il n° di
  processori da simulare, creandone i processi relativi e creando ed inizializzando
  le eventuali strutture di supporto (semafori/memoria condivisa/array dei risultati)<br>
  - Entrata in un ciclo per ogni operazione da simulare:<br>
- - se id != 0: attende che il processo id sia libero, salva l'eventuale risultato
- del calcolo precendente nell'array dei risultati e interagisce con id
- passandogli il comando da simulare.<br>
+ - se id != 0: accoda il comando da simulare nel canale di id, attendendo
+ solo se il canale è pieno.<br>
+ I comandi accodati vengono pubblicati al figlio a lotti di dimensione_lotto.<br>
  Non deve attendere che il figlio abbia completato la simulazione.<br>
- - se id == 0: trova il primo processo libero e interagisce con esso.<br>
- Se non ci sono processi liberi attende che almeno uno lo sia.<br>
+ - se id == 0: accoda il comando nella coda di lavoro del figlio con meno
+ operazioni in attesa (a turno a parità di carico). I figli che non hanno
+ lavoro rubano metà delle operazioni dalla coda di lavoro più lunga.<br>
+ Attende solo se la coda di lavoro scelta è piena.<br>
  - Passati tutti i comandi attende l'esecuzione dei calcoli da parte dei figli.<br>
- - Salvataggio dei risultati e invio del comando di terminazione a tutti i figli.<br>
+ - Invio del comando di terminazione a tutti i figli.<br>
  - Attesa che tutti i figli siano terminati.<br>
+ - Scrittura dei risultati, salvati dai figli direttamente nell'area di
+ appoggio nella posizione data dal n° di sequenza dell'operazione, e quindi
+ nell'ordine dell'input (in modalità streaming sono scritti man mano).<br>
  - Libera eventuali risorse.<br>
  - Esce.<br>
  */
 #include "functions.h"
+#include "parser.h"
+#include "binario.h"
+#include "scrittore.h"
+#include "lavoratore.h"
+#include "calcolo.h"
+#include "affinita.h"
+#include "appoggio.h"
+#include "cache.h"
+#include "statistiche.h"
+#include "attesa.h"
+#include "sportello.h"
+
+#include <sys/stat.h>
+#include <sys/prctl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <pthread.h>
 
-int fd;					/**< File descriptor del file da leggere(config.txt) e su cui scrivere output(res.txt) */
+#define FINESTRA 65536	/**< N° di risultati nella finestra circolare dell'area di appoggio (modalità streaming) */
+#define CONTROLLO_FIGLI 100	/**< Intervallo di controllo dei figli processo mentre il padre è bloccato (ms) */
+
+int fd;					/**< File descriptor del file su cui scrivere output(res.txt) */
+scrittore output;		/**< Scrittore bufferizzato sul file di output */
+bool scrittura_thread = false;	/**< Flag: scritture sul file di output in un thread dedicato */
+char* file_input = "config.txt";	/**< File di configurazione da leggere */
+char* file_output = "res.txt";		/**< File su cui scrivere i risultati */
+bool streaming = false;	/**< Flag: modalità streaming */
+bool output_binario = false;	/**< Flag: risultati in formato binario */
+lettore* input;			/**< Lettore incrementale dell'input (modalità streaming) */
+dati letta;				/**< Ultima operazione letta in modalità streaming */
 int i;					/**< Contatore per i cicli */
-dati* token;			/**< Struttura dati di supporto alla tokenizzazione di una linea letta dal padre */
-char c;					/**< Buffer per la lettura carattere-per-carattere */
-char n_proc[3]; 		/**< Buffer per il salvataggio del n° di processi da creare */
-char *temp;				/**< Stringa per il salvataggio di una singola linea del file di configurazione */
+int n;					/**< Indice dell'operazione corrente */
+lavoro job;				/**< Contenuto del file di configurazione */
+dati* token;			/**< Operazione corrente */
+char n_proc[12]; 		/**< Buffer per il salvataggio del n° di processi da creare */
+char shmid_canali[12];	/**< Buffer per il salvataggio dell'id del segmento dei canali */
+char sem_empty[12];		/**< Buffer per il salvataggio dell'identificatore del vettore di semafori empty */
+char sem_full[12];		/**< Buffer per il salvataggio dell'identificatore del vettore di semafori full */
+char shmid_appoggio[12];	/**< Buffer per il salvataggio dell'id dell'area di appoggio */
+char n_risultati[12];		/**< Buffer per il salvataggio del n° di risultati dell'area di appoggio */
+char tempi_appoggio[2];		/**< Buffer per il salvataggio della presenza del vettore dei tempi nell'area di appoggio */
+char voci_appoggio[12];		/**< Buffer per il salvataggio del n° di voci della cache dei risultati nell'area di appoggio */
 int row_count=0; 		/**< Contatore del n° di operazioni da eseguire */
-dati* buffer_comune;	/**< Buffer per la memoria condivisa */
+canale* buffer_comune;	/**< Canali dei figli nella memoria condivisa */
 int id; 				/**< Intero per il salvataggio dell'id del processore con cui il padre deve interagire */
 char* write_message;	/**< Stringa per la memorizzazione dei messaggi per le system call write */
 int numero_processi;	/**< Variabile contenente il numero di processi letto dal file di configurazione */
+res* array_risultati;	/**< Array dei risultati nell'ordine dell'input, nell'area di appoggio */
+area_appoggio appoggio;	/**< Area di appoggio dei vettori di operazioni e risultati */
+bool pagine_enormi = false;	/**< Flag: area di appoggio su pagine enormi */
+char* file_statistiche = NULL;	/**< File a cui aggiungere le misure delle prestazioni (opzione -S), NULL se non misurate */
+statistiche misure;		/**< Misure delle prestazioni */
+int res_count = 0; 		/**< N° di operazioni completate dai figli */
+unsigned int inviate = 0;	/**< N° di sequenza della prossima operazione da inviare */
+unsigned int scritti = 0;	/**< N° di risultati scritti in ordine sul file di output (modalità streaming) */
+int* destinazione;		/**< Per ogni posizione dei risultati, figlio a cui è stata inviata l'operazione (modalità streaming e operazioni con dipendenze) */
+unsigned int* raccolti;	/**< Per ogni figlio, indice del prossimo risultato da raccogliere dal suo canale */
+unsigned int* prossimo;	/**< Per ogni figlio, indice del prossimo slot da scrivere (pubblicato o meno) */
+unsigned int* raccolti_lavoro;	/**< Per ogni figlio, indice del prossimo risultato da raccogliere dalla sua coda di lavoro */
+unsigned int* prossimo_lavoro;	/**< Per ogni figlio, indice del prossimo slot da scrivere nella sua coda di lavoro */
+attesa* attese_padre;	/**< Per ogni figlio, stato delle attese del padre verso il figlio */
+int ultimo_scelto = 0;	/**< Ultimo figlio a cui è stata assegnata un'operazione con id 0 */
+int cpu_figli[MAX_CPU];	/**< CPU a cui fissare i figli (opzione -c) */
+int n_cpu_figli = 0;	/**< N° di CPU in cpu_figli, 0 se i figli non vanno fissati */
+int dimensione_lotto = 1;	/**< N° di operazioni accodate a un figlio prima di pubblicarle */
+bool demone = false;	/**< Flag: modalità demone */
+unsigned int voci_cache = 0;	/**< N° di voci della cache dei risultati (opzione -C), 0 se non attiva */
+accesso sportello_demone;	/**< Sportello da cui il demone riceve i lavori */
+unsigned int inizio_lotto;	/**< N° di sequenza della prima operazione del lotto in esecuzione (modalità demone) */
+riferimento* riferimenti = NULL;	/**< Riferimenti degli operandi ai risultati precedenti, NULL se le operazioni sono indipendenti */
+unsigned int* mancanti;		/**< Per ogni operazione, n° di operandi non ancora calcolati */
+unsigned int* primo_dipendente;	/**< Per ogni operazione, posizione in dipendenti delle operazioni che ne usano il risultato (row_count+1 elementi) */
+unsigned int* dipendenti;	/**< Operazioni che usano il risultato di ciascuna operazione, raggruppate per operazione */
+unsigned int* pronte;		/**< Coda delle operazioni con tutti gli operandi calcolati, nell'ordine in cui lo diventano */
+unsigned int n_pronte = 0;	/**< N° di operazioni entrate nella coda delle pronte */
+unsigned int prima_pronta = 0;	/**< Posizione nella coda della prossima operazione pronta da inviare */
+unsigned int* in_volo;		/**< Operazioni inviate con dipendenti, il cui risultato non è ancora stato propagato */
+unsigned int n_in_volo = 0;	/**< N° di operazioni in in_volo */
+unsigned int dipendenza_attesa;	/**< Operazione di cui il padre attende il risultato per inviarne i dipendenti */
+pid_t* pid_figli = NULL;	/**< Pid dei figli, NULL se i figli sono thread */
+#ifdef MOTORE_THREAD
+bool figli_thread = true;	/**< Flag: figli eseguiti come thread invece che come processi */
+#else
+bool figli_thread = false;	/**< Flag: figli eseguiti come thread invece che come processi */
+#endif
 
-int main(int argc, char *argv[]){
+/**
+	@brief Procedura per la liberazione degli slot eseguiti dal figlio id
+
+	I figli salvano i risultati direttamente nell'area di appoggio: il padre
+	deve solo rendere riutilizzabili gli slot del canale già eseguiti e, dalla
+	coda di lavoro, quelli eseguiti in ordine (dal figlio o da chi li ha
+	rubati), fermandosi al primo non ancora eseguito.
+	@param id N° del figlio
+ */
+static void libera_slot(int id){
+    canale* ch = buffer_comune+id;
+    
+    raccolti[id] = __atomic_load_n(&ch->testa, __ATOMIC_ACQUIRE);
+    
+    while(raccolti_lavoro[id] != prossimo_lavoro[id] &&
+          __atomic_load_n(&ch->lavoro.slot[raccolti_lavoro[id] % CAPACITA_CANALE].res_disponibile, __ATOMIC_ACQUIRE))
+        raccolti_lavoro[id]++;
+}
+
+/**
+	@brief Procedura per la scrittura in ordine dei risultati pronti (modalità streaming)
+
+	Scrive sul file di output, nell'ordine dell'input, i risultati salvati
+	dai figli nella finestra circolare dell'area di appoggio, fermandosi al
+	primo non ancora pronto. In modalità demone li copia invece nello
+	sportello, nella posizione dell'operazione nel lotto.
+ */
+static void scrivi_risultati_pronti(void){
+    res* r;
+    
+    while(scritti != inviate && appoggio_pronto(&appoggio, scritti)){
+        r = &appoggio.risultati[scritti % appoggio.n_risultati];
+        
+        if(appoggio.tempi != NULL)
+            istogramma_aggiungi(&misure.latenze, appoggio.tempi[scritti % appoggio.n_risultati]);
+        
+        scritti++;
+        
+        if(demone)
+            sportello_demone.s->risultati[scritti - 1 - inizio_lotto] = *r;
+        else if(output_binario)
+            scrittore_record(&output, r);
+        else
+            scrittore_risultato(&output, scritti, r);
+        
+        LOG(LOG_OPERAZIONI, "\nScritto risultato %u sul file di output\n\n", scritti);
+    }
+}
+
+/**
+	@brief Procedura per la pubblicazione del lotto di operazioni di un figlio
+ 
+	Rende visibili al figlio id tutte le operazioni scritte nel suo canale e
+	nella sua coda di lavoro, aggiornandone la profondità massima, e lo
+	sveglia solo se questo è bloccato sul semaforo full.
+	@param id N° del figlio
+ */
+static void pubblica_lotto(int id){
+    canale* ch = buffer_comune+id;
+    unsigned int profondita = prossimo[id] - raccolti[id] + prossimo_lavoro[id] - raccolti_lavoro[id];
+    
+    if(ch->coda == prossimo[id] && ch->lavoro.coda == prossimo_lavoro[id])
+        return;
+    
+    if(profondita > ch->padre.profondita_massima)
+        ch->padre.profondita_massima = profondita;
+    
+    __atomic_store_n(&ch->coda, prossimo[id], __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ch->lavoro.coda, prossimo_lavoro[id], __ATOMIC_SEQ_CST);
+    
     /**
-     Stampo un intestazione per il programma.
+     Sveglio il figlio se si è bloccato in attesa di operazioni.
      */
-    my_write(1, "**************************************************************************\n");
-    my_write(1, "*			SIMULATORE CALCOLO PARALLELO			 *\n");
-    my_write(1, "**************************************************************************\n");
-    my_write(1, "		PADRE 					FIGLIO\n\n");
+    if(__atomic_exchange_n(&ch->figlio_attende, 0, __ATOMIC_SEQ_CST) == 1)
+        sem_signal(semid_full, id);
+}
+
+/**
+	@brief Funzione che verifica se il figlio id ha liberato uno slot del canale pieno
+ */
+static bool canale_libero(const void* arg){
+    int id = (int) (intptr_t) arg;
+    
+    return __atomic_load_n(&(buffer_comune+id)->testa, __ATOMIC_SEQ_CST) != raccolti[id];
+}
+
+/**
+	@brief Funzione che verifica se la prima operazione della coda di lavoro piena del figlio id è stata eseguita
+ */
+static bool lavoro_libero(const void* arg){
+    int id = (int) (intptr_t) arg;
+    
+    return __atomic_load_n(&(buffer_comune+id)->lavoro.slot[raccolti_lavoro[id] % CAPACITA_CANALE].res_disponibile, __ATOMIC_SEQ_CST);
+}
+
+/**
+	@brief Funzione che verifica se il risultato più vecchio non ancora scritto è pronto
+ */
+static bool risultato_pronto(const void* arg){
+    (void) arg;
+    
+    return __atomic_load_n(&appoggio.pronti[scritti % appoggio.n_risultati], __ATOMIC_SEQ_CST) == scritti + 1;
+}
+
+/**
+	@brief Procedura di terminazione per un errore dopo la creazione dei figli
+
+	Libera le risorse senza scrivere un file di output parziale. La
+	rimozione dei semafori sveglia con un errore i figli ancora bloccati e
+	gli eventuali clienti del demone.
+ */
+static void interrompi(void){
+    free_resources(buffer_comune, shmid, semid_empty, semid_full);
+    appoggio_rilascia(&appoggio);
+    
+    if(demone)
+        sportello_rimuovi(&sportello_demone);
+    
+    istanza_termina();
+    exit(1);
+}
+
+/**
+	@brief Procedura di attesa che il figlio id renda vera la condizione pronto
+
+	Attende prima attivamente secondo la politica di attesa (vedi attesa.h);
+	se la condizione non si avvera segnala al figlio che sta per bloccarsi,
+	ricontrolla la condizione e si blocca sul semaforo empty del figlio,
+	aggiungendo la durata del blocco ai contatori del padre relativi al figlio.<br>
+	Se i figli sono processi controlla ogni CONTROLLO_FIGLI ms che il figlio
+	sia ancora in esecuzione: un figlio terminato non segnalerebbe più il
+	semaforo e il padre resterebbe bloccato per sempre.
+	@param id N° del figlio
+	@param pronto Funzione che verifica la condizione attesa, con argomento id
+ */
+static void attendi_figlio(int id, bool (*pronto)(const void*)){
+    canale* ch = buffer_comune+id;
+    long long attesa;
+    
+    if(attesa_attiva(&attese_padre[id], pronto, (const void *) (intptr_t) id))
+        return;
+    
+    __atomic_store_n(&ch->padre_attende, 1, __ATOMIC_SEQ_CST);
+    if(!pronto((const void *) (intptr_t) id)){
+        attesa = statistiche_adesso();
+        
+        while(!sem_timedwait(semid_empty, id, CONTROLLO_FIGLI)){
+            if(pid_figli != NULL && !processo_attivo(pid_figli[id])){
+                sprintf(sprintf_buffer, "ERRORE: Figlio %d terminato durante l'esecuzione\n", id + 1);
+                my_write(1, sprintf_buffer);
+                interrompi();
+            }
+        }
+        
+        attesa = statistiche_adesso() - attesa;
+        
+        ch->padre.attesa_ns += attesa;
+        istogramma_aggiungi(&ch->padre.attese, attesa);
+    }
+    __atomic_store_n(&ch->padre_attende, 0, __ATOMIC_SEQ_CST);
+    
+    attesa_termina(&attese_padre[id]);
+}
+
+/**
+	@brief Procedura di attesa dei risultati (modalità streaming)
+
+	Finchè ci sono più di massimo operazioni inviate di cui non è stato
+	scritto il risultato, scrive i risultati pronti e, se il più vecchio non
+	è ancora pronto, pubblica il lotto del figlio a cui è stato inviato e
+	attende che questo lo esegua.
+	@param massimo N° di risultati che possono restare da scrivere
+ */
+static void attendi_risultati(unsigned int massimo){
+    int w;
+    
+    while(inviate - scritti > massimo){
+        scrivi_risultati_pronti();
+        
+        if(inviate - scritti <= massimo)
+            break;
+        
+        LOG(LOG_OPERAZIONI, "Attendo il risultato %u\n", scritti + 1);
+        w = destinazione[scritti % appoggio.n_risultati];
+        pubblica_lotto(w);
+        attendi_figlio(w, risultato_pronto);
+    }
+}
+
+/**
+	@brief Procedura per l'invio di un'operazione a un figlio
+ 
+	Libera gli slot eseguiti dal figlio id e scrive l'operazione nel
+	suo canale, pubblicando il lotto quando raggiunge dimensione_lotto
+	operazioni. Attende il figlio solo se il canale è pieno.
+	@param id N° del figlio
+	@param op Operazione da accodare
+ */
+static void invia_operazione(int id, dati* op){
+    canale* ch = buffer_comune+id;
+    unsigned int coda = prossimo[id];
+    
+    libera_slot(id);
     
     /**
-     *	<h2>SETUP CONFIGURAZIONE</h2>
-     *	Apertura del file config.txt in sola lettura tramite la system call open().
+     Se il canale è pieno pubblico le operazioni non ancora visibili al figlio
+     e attendo che il figlio liberi almeno uno slot.
      */
-    if((fd=open("config.txt", O_RDONLY, 0444)) == -1){
-        my_write(1, "ERRORE: Apertura file config.txt\n");
+    while(coda - raccolti[id] == CAPACITA_CANALE){
+        pubblica_lotto(id);
+        attendi_figlio(id, canale_libero);
+        libera_slot(id);
+    }
+    
+    ch->slot[coda % CAPACITA_CANALE] = *op;
+    prossimo[id] = coda + 1;
+    
+    if(prossimo[id] - ch->coda >= dimensione_lotto)
+        pubblica_lotto(id);
+}
+
+/**
+	@brief Funzione di scelta del figlio a cui assegnare un'operazione con id 0
+
+	Sceglie il figlio con meno operazioni in attesa di essere eseguite tra
+	canale e coda di lavoro, scorrendo i figli a partire dal successivo
+	all'ultimo scelto, così che a parità di carico le operazioni siano
+	distribuite a turno.
+	@return N° del figlio scelto
+ */
+static int scegli_figlio(void){
+    canale* ch;
+    unsigned int carico, minimo = ~0u;
+    int j, k, scelto = 0;
+    
+    for(j=1; j<=numero_processi; j++){
+        k = (ultimo_scelto + j) % numero_processi;
+        ch = buffer_comune+k;
+        carico = prossimo[k] - __atomic_load_n(&ch->testa, __ATOMIC_ACQUIRE)
+               + prossimo_lavoro[k] - __atomic_load_n(&ch->lavoro.testa, __ATOMIC_ACQUIRE);
+        
+        if(carico < minimo){
+            minimo = carico;
+            scelto = k;
+            
+            if(carico == 0)
+                break;
+        }
+    }
+    
+    ultimo_scelto = scelto;
+    
+    return scelto;
+}
+
+/**
+	@brief Procedura per l'invio di un'operazione con id 0 a un figlio
+
+	Libera gli slot eseguiti dal figlio id e scrive l'operazione nella
+	sua coda di lavoro, pubblicando il lotto quando raggiunge dimensione_lotto
+	operazioni. Attende il figlio solo se la coda di lavoro è piena e la sua
+	prima operazione non è ancora stata eseguita.
+	@param id N° del figlio
+	@param op Operazione da accodare
+ */
+static void invia_lavoro(int id, dati* op){
+    canale* ch = buffer_comune+id;
+    unsigned int coda = prossimo_lavoro[id];
+    dati* slot;
+    
+    libera_slot(id);
+    
+    while(coda - raccolti_lavoro[id] == CAPACITA_CANALE){
+        LOG(LOG_OPERAZIONI, "Coda di lavoro del figlio %d piena, attendo\n", id + 1);
+        pubblica_lotto(id);
+        attendi_figlio(id, lavoro_libero);
+        libera_slot(id);
+    }
+    
+    slot = &ch->lavoro.slot[coda % CAPACITA_CANALE];
+    *slot = *op;
+    slot->res_disponibile = false;
+    prossimo_lavoro[id] = coda + 1;
+    
+    if(prossimo_lavoro[id] - ch->lavoro.coda >= dimensione_lotto)
+        pubblica_lotto(id);
+}
+
+/**
+	@brief Procedura di apertura del file di output
+
+	Crea il file di output (o usa lo standard output se file_output è "-")
+	e vi scrive l'intestazione.
+ */
+static void apri_output(void){
+    if(strcmp(file_output, "-") == 0)
+        fd = 1;
+    else if((fd=creat(file_output, 0777)) == -1){
+        sprintf(sprintf_buffer, "ERRORE: Creazione file %s\n", file_output);
+        my_write(1, sprintf_buffer);
+        free_resources(buffer_comune, shmid, semid_empty, semid_full);
+        exit(1);
+    }
+    
+    if(scrittore_apri(&output, fd, scrittura_thread) == -1){
+        my_write(1, "ERRORE: Creazione buffer di scrittura dei risultati\n");
+        free_resources(buffer_comune, shmid, semid_empty, semid_full);
         exit(1);
     }
     
     /**
-     * 	Lettura del n° di operazioni da salvare dal file config.txt.
-     *	Eseguo un ciclo While finchè ci sono caratteri da leggere nel file e incremento
-     *	un contatore ogni volta che incontro il carattere new_line.
+     Stampo un intestazione nel file di output: nel formato binario il n° di
+     risultati è noto solo se non sono in modalità streaming.
      */
-    while(read(fd, &c, 1) > 0){
-        if(c == '\n')
-            row_count++;
+    if(output_binario){
+        binario_scrivi_intestazione(fd, MAGIC_RISULTATI, streaming ? -1 : row_count);
+        return;
     }
     
-    sprintf(sprintf_buffer, "Ci sono %d operazioni da svolgere\n\n", row_count);
-    my_write(1, sprintf_buffer);
+    scrittore_accoda(&output, "*************************\n"
+                              "*      RISULTATI        *\n"
+                              "*************************\n", 78);
+}
+
+/**
+	@brief Funzione eseguita dal lettore mentre l'input non ha dati disponibili
+
+	Pubblica i lotti incompleti, così che i figli possano eseguirli subito,
+	scrive i risultati pronti e avvia la scrittura di quelli ancora nel
+	buffer, così da non ritardarli.
+	@return true se ci sono ancora operazioni inviate di cui attendere il risultato
+ */
+static bool attesa_input(void){
+    int j;
+    
+    for(j=0; j<numero_processi; j++)
+        pubblica_lotto(j);
+    
+    scrivi_risultati_pronti();
+    scrittore_svuota(&output);
+    
+    return scritti != inviate;
+}
+
+/**
+	@brief Procedura di costruzione del grafo delle dipendenze tra le operazioni
+
+	Conta per ogni operazione gli operandi "$k" non ancora calcolati e
+	raggruppa per ogni operazione quelle che ne usano il risultato;
+	le operazioni senza riferimenti sono subito pronte, nell'ordine dell'input.
+ */
+static void prepara_dipendenze(void){
+    unsigned int k, r[2], *posizione;
+    int j;
+    
+    riferimenti = job.riferimenti;
+    mancanti = (unsigned int *) calloc(row_count, sizeof(unsigned int));
+    primo_dipendente = (unsigned int *) calloc(row_count + 1, sizeof(unsigned int));
+    pronte = (unsigned int *) malloc(sizeof(unsigned int) * row_count);
+    in_volo = (unsigned int *) malloc(sizeof(unsigned int) * row_count);
+    destinazione = (int *) malloc(sizeof(int) * row_count);
     
     /**
-     *	Riposiziono il cursore all'inizio del file tramite la system call lseek().
+     Conto i dipendenti di ogni operazione e ne ricavo le posizioni in dipendenti.
      */
-    if(lseek(fd, 0, SEEK_SET) == -1){
-        my_write(1, "ERRORE: riposizionamento cursore a inizio file\n");
-        exit(1);
+    for(k=0; k<row_count; k++){
+        r[0] = riferimenti[k].op1;
+        r[1] = riferimenti[k].op2;
+        
+        for(j=0; j<2; j++){
+            if(r[j] != 0){
+                mancanti[k]++;
+                primo_dipendente[r[j]]++;
+            }
+        }
+        
+        if(mancanti[k] == 0)
+            pronte[n_pronte++] = k;
     }
     
-    i = 0;
+    for(k=0; k<row_count; k++)
+        primo_dipendente[k+1] += primo_dipendente[k];
+    
+    dipendenti = (unsigned int *) malloc(sizeof(unsigned int) * (primo_dipendente[row_count] + 1));
+    posizione = (unsigned int *) malloc(sizeof(unsigned int) * row_count);
+    memcpy(posizione, primo_dipendente, sizeof(unsigned int) * row_count);
+    
+    for(k=0; k<row_count; k++){
+        if(riferimenti[k].op1 != 0)
+            dipendenti[posizione[riferimenti[k].op1 - 1]++] = k;
+        if(riferimenti[k].op2 != 0)
+            dipendenti[posizione[riferimenti[k].op2 - 1]++] = k;
+    }
+    
+    free(posizione);
+    
+    LOG(LOG_FASI, "%u riferimenti ai risultati precedenti: %u operazioni subito pronte\n\n", primo_dipendente[row_count], n_pronte);
+}
+
+/**
+	@brief Procedura di propagazione dei risultati calcolati ai dipendenti
+
+	Per ogni operazione inviata con dipendenti il cui risultato è pronto,
+	decrementa gli operandi mancanti dei dipendenti e accoda alle pronte
+	quelli che hanno tutti gli operandi.
+ */
+static void propaga_risultati(void){
+    unsigned int j, d, k, m = 0;
+    
+    for(j=0; j<n_in_volo; j++){
+        k = in_volo[j];
+        
+        if(!appoggio_pronto(&appoggio, k)){
+            in_volo[m++] = k;
+            continue;
+        }
+        
+        for(d=primo_dipendente[k]; d<primo_dipendente[k+1]; d++)
+            if(--mancanti[dipendenti[d]] == 0)
+                pronte[n_pronte++] = dipendenti[d];
+    }
+    
+    n_in_volo = m;
+}
+
+/**
+	@brief Funzione che verifica se il risultato dell'operazione attesa è pronto
+ */
+static bool dipendenza_pronta(const void* arg){
+    (void) arg;
+    
+    return __atomic_load_n(&appoggio.pronti[dipendenza_attesa % appoggio.n_risultati], __ATOMIC_SEQ_CST) == dipendenza_attesa + 1;
+}
+
+/**
+	@brief Funzione che restituisce la prossima operazione pronta (operazioni con dipendenze)
+
+	Se nessuna operazione è pronta propaga i risultati calcolati e, se
+	ancora nessuna lo diventa, pubblica i lotti incompleti e attende il
+	risultato dell'operazione inviata da più tempo tra quelle con dipendenti.
+	Sostituisce quindi i riferimenti con i risultati e assegna all'operazione
+	come n° di sequenza la sua posizione nell'input.
+	@return Operazione da eseguire, NULL se sono state inviate tutte
+ */
+static dati* prossima_pronta(void){
+    dati* op;
+    unsigned int k;
+    int j;
+    
+    if(inviate == (unsigned int) row_count)
+        return NULL;
+    
+    while(prima_pronta == n_pronte){
+        propaga_risultati();
+        
+        if(prima_pronta != n_pronte)
+            break;
+        
+        for(j=0; j<numero_processi; j++)
+            pubblica_lotto(j);
+        
+        dipendenza_attesa = in_volo[0];
+        LOG(LOG_OPERAZIONI, "Nessuna operazione pronta, attendo il risultato %u\n", dipendenza_attesa + 1);
+        attendi_figlio(destinazione[dipendenza_attesa], dipendenza_pronta);
+    }
+    
+    k = pronte[prima_pronta++];
+    op = &job.operazioni[k];
+    
+    if(riferimenti[k].op1 != 0)
+        op->num1 = array_risultati[riferimenti[k].op1 - 1].res;
+    if(riferimenti[k].op2 != 0)
+        op->num2 = array_risultati[riferimenti[k].op2 - 1].res;
+    
+    if(primo_dipendente[k+1] != primo_dipendente[k])
+        in_volo[n_in_volo++] = k;
+    
+    op->indice = k;
+    inviate++;
+    
+    return op;
+}
+
+/**
+	@brief Funzione che restituisce la prossima operazione da eseguire
+
+	Preleva l'operazione dal vettore caricato da carica_file() o, in modalità
+	streaming, la legge dall'input, e le assegna il n° di sequenza che
+	determina la posizione del suo risultato. Se le operazioni hanno
+	dipendenze le preleva in ordine di dipendenza con prossima_pronta().
+	@return Operazione da eseguire, NULL a fine input
+ */
+static dati* prossima_operazione(void){
+    dati* op;
+    int esito;
+    
+    if(riferimenti != NULL)
+        return prossima_pronta();
+    
+    if(!streaming){
+        if(n == row_count)
+            return NULL;
+        
+        op = &job.operazioni[n++];
+    } else {
+        if((esito = lettore_operazione(input, &letta)) == -1){
+            free_resources(buffer_comune, shmid, semid_empty, semid_full);
+            exit(1);
+        }
+        
+        if(esito == 0)
+            return NULL;
+        
+        op = &letta;
+    }
+    
+    op->indice = inviate++;
+    
+    return op;
+}
+
+/**
+	@brief Procedura per l'invio di un'operazione al figlio indicato dal suo id
+
+	Accoda l'operazione nel canale del figlio id se id != 0, altrimenti
+	nella coda di lavoro del figlio meno carico.
+	@param token Operazione da eseguire, con il suo n° di sequenza
+ */
+static void esegui_operazione(dati* token){
     /**
-     *	Lettura del n° di processi da simulare dal file di configurazione.<br>
-     *	Tale valore è contenuto nella prima riga del file, quindi eseguo un ciclo
-     *	di lettura fino al primo carattere new_line e salvo in un array di caratteri
-     *	le cifre lette.
+     In modalità streaming attendo che il risultato più vecchio lasci
+     libera la sua posizione nella finestra dei risultati.
      */
-    while(read(fd, &c, 1) > 0){
-        if(c == '\n')
-            break;
+    if(streaming)
+        attendi_risultati(appoggio.n_risultati - 1);
+    
+    /**
+     Con l'opzione -S salvo l'istante di accodamento dell'operazione.
+     */
+    if(appoggio.tempi != NULL)
+        appoggio.tempi[token->indice % appoggio.n_risultati] = statistiche_adesso();
+    
+    /**
+     Se la cache dei risultati contiene la terna salvo direttamente il
+     risultato, senza inviare l'operazione a un figlio.
+     */
+    if(appoggio.cache.voci != NULL && cache_cerca(&appoggio.cache, token)){
+        LOG(LOG_OPERAZIONI, "Risultato di %d %c %d trovato nella cache\n\n", token->num1, token->op, token->num2);
+        
+        if(appoggio.tempi != NULL)
+            appoggio.tempi[token->indice % appoggio.n_risultati] = 0;
+        
+        appoggio_salva(&appoggio, token);
+        
+        if(streaming)
+            scrivi_risultati_pronti();
         
-        n_proc[i++] = c;
+        return;
     }
     
     /**
-     *	Salvo in una variabile intera il n° di processi da creare.
-     *	Utilizzo la funzione atoi per convertire la stringa in intero.
+     Se l'id letto è diverso da 0
      */
-    numero_processi=atoi(n_proc);
+    if(token->id_sem != 0)
+    {
+        /**
+         Devo interagire con il figlio id.<br>
+         Stampo un messaggio di notifica e salvo in una variabile il n°
+         del processo con cui dovrò interagire.
+         */
+        LOG(LOG_OPERAZIONI, "Attendo figlio %d\n", token->id_sem);
+        id = token->id_sem - 1; /* Assegno a id il valore del semaforo con cui devo interagire */
+        
+        /**
+         Raccolgo gli eventuali risultati precedenti di id e accodo i dati
+         appena letti nel suo canale.
+         */
+        invia_operazione(id, token);
+    }
+    /**
+     Se l'id letto è uguale a 0 scelgo il figlio meno carico e accodo
+     l'operazione nella sua coda di lavoro, da cui i figli inattivi
+     possono rubarla.
+     */
+    else
+    {
+        id = scegli_figlio();
+        
+        LOG(LOG_OPERAZIONI, "Figlio%d è il meno carico\n", id + 1);
+        
+        invia_lavoro(id, token);
+    }
     
-    int res_count = 0; 				/* Contatore per le scritture nella struttura dati dei risultati */
-    pid_t proc[numero_processi]; 	/* Vettore contenente i pid dei processi */
-    res array_risultati[row_count];	/* Array dei risultati */
+    /**
+     Stampo un messaggio di notifica dell'avvenuta scrittura.
+     */
+    LOG(LOG_OPERAZIONI, "Scrittura dati a figlio %d completata\n\n", id + 1);
     
     /**
-     *	Creazione di un vettore di semafori empty per coordinare
-     *	le operazioni tra processo padre e figli.<br>
-     *	Creo un semaforo per ogni processo che segnala al padre
-     *	la disponibilità del figlio ad eseguire operazioni.
+     Ricordo a quale figlio è stata inviata l'operazione, per poterne
+     attendere il risultato, e in modalità streaming scrivo i risultati pronti.
      */
-    if((semid_empty = semget(EMPTYKEY, numero_processi, IPC_CREAT | IPC_EXCL | 0777)) == -1){
-        my_write(1, "ERRORE: Creazione vettore di semafori empty\n");
+    if(destinazione != NULL)
+        destinazione[token->indice % appoggio.n_risultati] = id;
+    
+    if(streaming)
+        scrivi_risultati_pronti();
+}
+
+/**
+	@brief Funzione che verifica se il lotto dello sportello può essere eseguito
+
+	Rifiuta i lotti contenenti operazioni con id negativo o con un operatore
+	diverso da +, -, * e / (come il parser): un cliente scrive direttamente
+	nello sportello, e l'operatore 'K' terminerebbe un figlio del demone.
+	@param sp Sportello contenente il lotto
+	@return true se il lotto può essere eseguito
+ */
+static bool lotto_valido(const sportello* sp){
+    int k;
+    
+    if(sp->n < 0 || sp->n > SPORTELLO_CAPACITA)
+        return false;
+    
+    for(k=0; k<sp->n; k++)
+        if(sp->operazioni[k].id_sem < 0 || !operatore_valido(sp->operazioni[k].op))
+            return false;
+    
+    return true;
+}
+
+/**
+	@brief Procedura di esecuzione dei lavori ricevuti dallo sportello (modalità demone)
+
+	Per ogni lotto ricevuto da un cliente invia le operazioni ai figli,
+	assegnando ciclicamente gli id maggiori del n° di figli, pubblica i
+	lotti incompleti e attende tutti i risultati, copiati nello sportello
+	da scrivi_risultati_pronti(), quindi sveglia il cliente.<br>
+	Termina alla richiesta di arresto, lasciando al chiamante la terminazione
+	dei figli.
+ */
+static void esegui_demone(void){
+    sportello* sp = sportello_demone.s;
+    unsigned int numero;
+    int k, j;
+    
+    LOG(LOG_FASI, "Demone in attesa di lavori con %d figli\n\n", numero_processi);
+    
+    while(1){
+        sem_wait(sportello_demone.semid, SPORTELLO_RICHIESTA);
+        
+        /**
+         Riporto nella risposta il numero della richiesta, letto prima del
+         lotto: il cliente scarta le risposte con un numero diverso.
+         */
+        numero = __atomic_load_n(&sp->richiesta, __ATOMIC_SEQ_CST);
+        
+        if(sp->comando == SPORTELLO_ARRESTA){
+            LOG(LOG_FASI, "Richiesta di arresto del demone\n\n");
+            sp->esito = 0;
+            sp->risposta = numero;
+            return;
+        }
+        
+        if(!lotto_valido(sp)){
+            LOG(LOG_ERRORI, "ATTENZIONE: Lotto rifiutato: operazione con id negativo o operatore non valido\n");
+            sp->esito = -1;
+            sp->risposta = numero;
+            sem_signal(sportello_demone.semid, SPORTELLO_RISPOSTA);
+            continue;
+        }
+        
+        inizio_lotto = inviate;
+        
+        for(k=0; k<sp->n; k++){
+            letta = sp->operazioni[k];
+            
+            if(letta.id_sem != 0)
+                letta.id_sem = (letta.id_sem - 1) % numero_processi + 1;
+            
+            letta.indice = inviate++;
+            esegui_operazione(&letta);
+        }
+        
+        /**
+         Pubblico i lotti incompleti e attendo che tutti i risultati del lotto
+         siano stati copiati nello sportello.
+         */
+        for(j=0; j<numero_processi; j++)
+            pubblica_lotto(j);
+        
+        attendi_risultati(0);
+        
+        LOG(LOG_FASI, "Eseguito un lotto di %d operazioni\n", sp->n);
+        
+        sp->esito = 0;
+        sp->risposta = numero;
+        sem_signal(sportello_demone.semid, SPORTELLO_RISPOSTA);
+    }
+}
+
+/**
+	@brief Procedura che fissa il figlio id alla sua CPU
+
+	Chiamata dal figlio stesso (processo prima di execvp o thread) se è stata
+	indicata l'opzione -c.
+	@param id N° del figlio
+ */
+static void fissa_figlio(int id){
+    int cpu = cpu_figli[id % n_cpu_figli];
+    
+    if(affinita_fissa(cpu) == -1)
+        LOG(LOG_ERRORI, "ATTENZIONE: Impossibile fissare il figlio %d alla CPU %d\n", id + 1, cpu);
+}
+
+/**
+	@brief Funzione eseguita dai figli creati come thread
+
+	@param arg N° del figlio
+	@return NULL
+ */
+static void* thread_figlio(void* arg){
+    if(n_cpu_figli > 0)
+        fissa_figlio((int) (intptr_t) arg);
+    
+    lavoratore_esegui(buffer_comune, numero_processi, &appoggio, (int) (intptr_t) arg);
+    
+    return NULL;
+}
+
+int main(int argc, char *argv[]){
+    int opzione;				/* Opzione letta dalla riga di comando */
+    struct stat info_input;		/* Informazioni sul file di input */
+    char descrizione[512];		/* Messaggio d'uso o descrizione della simulazione per il file delle statistiche */
+    int stato;					/* Stato di terminazione di un figlio processo */
+    void* esito_figlio;			/* Valore restituito da un figlio thread */
+    int figli_falliti = 0;		/* N° di figli terminati in modo anomalo */
+    int mancanti = 0;			/* N° di risultati non salvati dai figli */
+    
+    statistiche_inizializza(&misure);
+    
+    /**
+     Leggo il livello di log dalla variabile d'ambiente e le opzioni dalla
+     riga di comando.
+     */
+    log_inizializza();
+    
+    if(attesa_inizializza() == -1){
+        my_write(1, "ERRORE: Politica di attesa non valida nella variabile d'ambiente " ATTESA_ENV "\n");
         exit(1);
     }
     
+    while((opzione = getopt(argc, argv, "b:i:o:sBWl:TPc:HS:a:D:C:")) != -1){
+        switch(opzione){
+            case 'B':
+                output_binario = true;
+                break;
+            case 'W':
+                scrittura_thread = true;
+                break;
+            case 'T':
+                figli_thread = true;
+                break;
+            case 'P':
+                figli_thread = false;
+                break;
+            case 'H':
+                pagine_enormi = true;
+                break;
+            case 'S':
+                file_statistiche = optarg;
+                break;
+            case 'a':
+                if(attesa_imposta(optarg) == 0){
+                    setenv(ATTESA_ENV, optarg, 1);
+                    break;
+                }
+                goto uso;
+            case 'c':
+                if(strcmp(optarg, "auto") == 0)
+                    n_cpu_figli = affinita_topologia(cpu_figli, MAX_CPU);
+                else
+                    n_cpu_figli = affinita_lista(optarg, cpu_figli, MAX_CPU);
+                
+                if(n_cpu_figli > 0)
+                    break;
+                goto uso;
+            case 'C':
+                voci_cache = cache_voci(atoi(optarg) > 0 ? atoi(optarg) : 0);
+                if(voci_cache >= 1 && voci_cache <= CACHE_MASSIMA)
+                    break;
+                goto uso;
+            case 'D':
+                demone = true;
+                if((numero_processi = atoi(optarg)) >= 1)
+                    break;
+                goto uso;
+            case 'i':
+                file_input = optarg;
+                break;
+            case 'o':
+                file_output = optarg;
+                break;
+            case 's':
+                streaming = true;
+                break;
+            case 'l':
+                if(optarg[0] >= '0' && optarg[0] <= '0' + LOG_OPERAZIONI && optarg[1] == '\0'){
+                    livello_log = optarg[0] - '0';
+                    break;
+                }
+                goto uso;
+            case 'b':
+                dimensione_lotto = atoi(optarg);
+                if(dimensione_lotto >= 1 && dimensione_lotto <= CAPACITA_CANALE)
+                    break;
+                /* Valore non valido: prosegue nel caso di default */
+            default:
+            uso:
+                snprintf(descrizione, sizeof(descrizione), "Uso: %s [-b dimensione_lotto (1-%d)] [-i input] [-o output] [-s] [-B] [-W] [-l livello (0-%d)] [-T|-P] [-c cpu|auto] [-H] [-S statistiche] [-a blocca|adattiva|us] [-D figli] [-C voci]\n", argv[0], CAPACITA_CANALE, LOG_OPERAZIONI);
+                my_write(1, descrizione);
+                exit(1);
+        }
+    }
+    
     /**
-     *	Inizializzo i semafori empty a 1.
+     Passo il livello di log ai figli attraverso l'ambiente ereditato da execvp().
      */
-    for(i=0; i<numero_processi; i++){
-        if((semctl(semid_empty, i, SETVAL, 1)) == -1){
-            sprintf(sprintf_buffer, "ERRORE: Inizializzazione semaforo empty n° %d\n", i+1);
-            my_write(1, sprintf_buffer);
+    sprintf(sprintf_buffer, "%d", livello_log);
+    setenv(LOG_ENV, sprintf_buffer, 1);
+    
+    /**
+     Stampo un intestazione per il programma.
+     */
+    LOG(LOG_FASI, "**************************************************************************\n");
+    LOG(LOG_FASI, "*			SIMULATORE CALCOLO PARALLELO			 *\n");
+    LOG(LOG_FASI, "**************************************************************************\n");
+    LOG(LOG_FASI, "		PADRE 					FIGLIO\n\n");
+    
+    /**
+     *	Rimuovo gli oggetti IPC lasciati dalle istanze terminate senza liberarli.
+     */
+    istanza_pulisci();
+    
+    /**
+     *	<h2>SETUP CONFIGURAZIONE</h2>
+     *	Se l'input non è un file regolare (pipe, FIFO o standard input) non
+     *	può essere mappato in memoria: attivo la modalità streaming.
+     */
+    if(strcmp(file_input, "-") == 0 || (stat(file_input, &info_input) == 0 && !S_ISREG(info_input.st_mode)))
+        streaming = true;
+    
+    if(demone){
+        /**
+         *	In modalità demone non c'è un file di input: i lavori arrivano dallo
+         *	sportello, che creo subito per rilevare un altro demone in esecuzione.
+         *	I lotti sono eseguiti come in modalità streaming, con la finestra
+         *	circolare dei risultati nell'area di appoggio.
+         */
+        streaming = true;
+        
+        if(sportello_crea(&sportello_demone, numero_processi) == -1){
+            my_write(1, "ERRORE: Creazione dello sportello (un altro demone è in esecuzione?)\n");
+            exit(1);
+        }
+        
+        istanza_registra(ISTANZA_SEMAFORI, sem_identificatore(sportello_demone.semid));
+        istanza_registra(ISTANZA_MEMORIA, sportello_demone.shmid);
+        
+        if(appoggio_crea(&appoggio, FINESTRA, voci_cache, file_statistiche != NULL, !figli_thread, pagine_enormi) == -1){
+            my_write(1, "ERRORE: Creazione dell'area di appoggio\n");
+            sportello_rimuovi(&sportello_demone);
+            exit(1);
+        }
+        
+        destinazione = (int *) malloc(sizeof(int) * FINESTRA);
+    } else if(streaming){
+        /**
+         *	In modalità streaming apro un lettore incrementale sull'input, che
+         *	legge la prima riga (n° di processi da simulare); le operazioni
+         *	vengono lette una alla volta durante l'esecuzione.
+         */
+        input = (lettore *) malloc(sizeof(lettore));
+        if(lettore_apri(input, file_input, attesa_input) == -1)
+            exit(1);
+        
+        numero_processi = input->numero_processi;
+        
+        LOG(LOG_FASI, "Modalità streaming: le operazioni vengono eseguite durante la lettura\n\n");
+        
+        /**
+         *	L'area di appoggio contiene solo la finestra circolare dei risultati,
+         *	scritti in ordine man mano che sono pronti.
+         */
+        if(appoggio_crea(&appoggio, FINESTRA, voci_cache, file_statistiche != NULL, !figli_thread, pagine_enormi) == -1){
+            my_write(1, "ERRORE: Creazione dell'area di appoggio\n");
             exit(1);
         }
+        
+        destinazione = (int *) malloc(sizeof(int) * FINESTRA);
+    } else {
+        /**
+         *	Altrimenti carico il file con la funzione carica_file(), che lo
+         *	mappa in memoria e ne analizza in un'unica passata la prima riga
+         *	(n° di processi da simulare) e le operazioni da svolgere.
+         */
+        if(carica_file(file_input, &job) == -1)
+            exit(1);
+        
+        numero_processi = job.numero_processi;
+        row_count = job.n_operazioni;
+        
+        LOG(LOG_FASI, "Ci sono %d operazioni da svolgere\n\n", row_count);
+        
+        /**
+         *	Creo l'area di appoggio con il vettore dei risultati, condivisa
+         *	con i figli se sono processi. Le operazioni restano nella memoria
+         *	del padre: i figli ricevono una copia di ciascuna nel proprio canale.
+         */
+        if(appoggio_crea(&appoggio, row_count, voci_cache, file_statistiche != NULL, !figli_thread, pagine_enormi) == -1){
+            my_write(1, "ERRORE: Creazione dell'area di appoggio\n");
+            exit(1);
+        }
+        
+        array_risultati = appoggio.risultati;
+        
+        /**
+         *	Se alcuni operandi sono risultati di operazioni precedenti costruisco
+         *	il grafo delle dipendenze: le operazioni vengono inviate man mano
+         *	che i loro operandi sono calcolati.
+         */
+        if(job.riferimenti != NULL)
+            prepara_dipendenze();
+    }
+    
+    LOG(LOG_FASI, "Area di appoggio di %zu KB su %s\n\n", appoggio.dimensione / 1024, appoggio_descrizione(&appoggio));
+    
+    if(voci_cache > 0)
+        LOG(LOG_FASI, "Cache dei risultati di %u voci (%zu KB) nell'area di appoggio\n\n", voci_cache, sizeof(voce_cache) * voci_cache / 1024);
+    
+    sprintf(n_proc, "%d", numero_processi);
+    sprintf(shmid_appoggio, "%d", appoggio.shmid);
+    sprintf(n_risultati, "%d", appoggio.n_risultati);
+    sprintf(tempi_appoggio, "%d", appoggio.tempi != NULL);
+    sprintf(voci_appoggio, "%u", voci_cache);
+    
+    pid_t proc[numero_processi]; 	/* Vettore contenente i pid dei processi */
+    pid_t padre = getpid();			/* Pid del padre, per verificarne la terminazione dai figli */
+    pthread_t thread_figli[numero_processi];	/* Vettore contenente i thread dei figli (opzione -T) */
+    dati terminazione = {0};		/* Operazione contenente il segnale di terminazione */
+    
+    raccolti = (unsigned int *) calloc(numero_processi, sizeof(unsigned int));
+    prossimo = (unsigned int *) calloc(numero_processi, sizeof(unsigned int));
+    raccolti_lavoro = (unsigned int *) calloc(numero_processi, sizeof(unsigned int));
+    prossimo_lavoro = (unsigned int *) calloc(numero_processi, sizeof(unsigned int));
+    attese_padre = (attesa *) calloc(numero_processi, sizeof(attesa));
+    
+    /**
+     *	Creazione di un vettore di semafori empty per coordinare
+     *	le operazioni tra processo padre e figli.<br>
+     *	Creo un semaforo per ogni processo su cui il padre si blocca
+     *	quando il canale del figlio è pieno.<br>
+     *	I semafori sono inizialmente posti a 0.<br>
+     *	Il vettore è privato dell'istanza (IPC_PRIVATE): il suo identificatore
+     *	è passato ai figli e annotato nel file dell'istanza, da cui viene
+     *	rimosso da una successiva esecuzione se elab2 termina senza liberarlo.
+     */
+    if((semid_empty = sem_crea(IPC_PRIVATE, numero_processi, 0)) == -1){
+        my_write(1, "ERRORE: Creazione vettore di semafori empty\n");
+        exit(1);
     }
     
+    istanza_registra(ISTANZA_SEMAFORI, sem_identificatore(semid_empty));
+    
     /**
      *	Creazione di un vettore di semafori full per coordinare
      *	le operazioni tra processo padre e figli.<br>
-     *	Creo un semaforo per ogni processo che segnala al figlio
-     *	la disponibilità di operandi su cui eseguire calcoli nel buffer.<br>
+     *	Creo un semaforo per ogni processo su cui il figlio si blocca
+     *	quando il suo canale è vuoto.<br>
      *	I semafori sono inizialmente posti a 0.
      */
-    if((semid_full = semget(FULLKEY, numero_processi, IPC_CREAT | IPC_EXCL | 0777)) == -1){
+    if((semid_full = sem_crea(IPC_PRIVATE, numero_processi, 0)) == -1){
         my_write(1, "ERRORE: Creazione vettore di semafori full\n");
         exit(1);
     }
     
+    istanza_registra(ISTANZA_SEMAFORI, sem_identificatore(semid_full));
+    
+    /**
+     *	Con i figli eseguiti come thread i canali e la coda dei processi liberi
+     *	sono allocati nella memoria privata del processo.
+     */
+    if(figli_thread){
+        shmid = -1;
+        
+        if((buffer_comune = (canale *) aligned_alloc(DIMENSIONE_PAGINA, dimensione_segmento(numero_processi))) == NULL){
+            my_write(1, "ERRORE: Allocazione dei canali dei figli\n");
+            free_resources(NULL, shmid, semid_empty, semid_full);
+            exit(1);
+        }
+    }
+    
     /**
-     *	Creazione di un segmento di memoria condivisa per ogni processore.
+     *	Altrimenti creo un segmento di memoria condivisa contenente un canale per
+     *	ogni processore seguito dalla coda dei processi liberi.
      */
-    if((shmid = shmget(SHMKEY, sizeof(dati) * numero_processi, 0777 | IPC_CREAT)) == -1){
+    else if((shmid = shmget(IPC_PRIVATE, dimensione_segmento(numero_processi), 0600 | IPC_CREAT)) == -1){
         my_write(1, "ERRORE: Creazione segmento di memoria condivisa\n");
         exit(1);
     }
@@ -147,16 +1180,37 @@ int main(int argc, char *argv[]){
      *	Mappo la memoria condivisa nell'area dati del padre a partire dal
      *	primo indirizzo disponibile.
      */
-    if((buffer_comune = (dati *) shmat(shmid, 0, 0666)) == (dati *) -1){
+    else if((buffer_comune = (canale *) shmat(shmid, 0, 0666)) == (canale *) -1){
         my_write(1, "ERRORE: Mappatura della memoria condivisa nell'area dati del padre\n");
         exit(1);
     }
     
     /**
-     *	Inizializzo tutte le flag res_disponibile a false
+     *	Marco subito il segmento per la rimozione: i figli vi si collegano
+     *	tramite l'identificatore e il segmento sparisce quando l'ultimo
+     *	processo collegato termina, anche se elab2 termina per un errore.
      */
-    for(i=0; i<numero_processi; i++){
-        (buffer_comune+i)->res_disponibile = false;
+    else {
+        shmctl(shmid, IPC_RMID, NULL);
+        
+        LOG(LOG_FASI, "Canali dei figli nel segmento %d (ipcstat -m %d)\n\n", shmid, shmid);
+    }
+    
+    /**
+     *	Inizializzo i canali vuoti.
+     */
+    memset(buffer_comune, 0, sizeof(canale) * numero_processi);
+    
+    /**
+     *	Con l'opzione -c sposto il canale di ogni figlio sul nodo NUMA della
+     *	CPU a cui il figlio verrà fissato (se il kernel non supporta NUMA il
+     *	canale resta dov'è).
+     */
+    if(n_cpu_figli > 0){
+        for(i=0; i<numero_processi; i++)
+            affinita_memoria(buffer_comune+i, sizeof(canale), affinita_nodo(cpu_figli[i % n_cpu_figli]));
+        
+        LOG(LOG_FASI, "Figli fissati a %d CPU a partire dalla CPU %d\n\n", n_cpu_figli, cpu_figli[0]);
     }
     
     /** <h2>CREAZIONE PROCESSI</h2>
@@ -165,10 +1219,36 @@ int main(int argc, char *argv[]){
      *	e inserisco i figli nell'array di processi.
      */
     
-    sprintf(sprintf_buffer, "Creazione di %d processi figli\n\n", numero_processi);
-    my_write(1, sprintf_buffer);
+    LOG(LOG_FASI, "Creazione di %d %s figli\n\n", numero_processi, figli_thread ? "thread" : "processi");
     
-    for(i=0; i<numero_processi; i++){
+    sprintf(shmid_canali, "%d", shmid);
+    sprintf(sem_empty, "%d", sem_identificatore(semid_empty));
+    sprintf(sem_full, "%d", sem_identificatore(semid_full));
+    
+    /**
+     *	Con l'opzione -T creo invece un thread per ogni processore, che esegue
+     *	la stessa routine dei processi figli sui canali in memoria privata.<br>
+     *	Seleziono il kernel di calcolo prima della creazione dei thread.
+     */
+    if(figli_thread){
+        calcolo_inizializza();
+        
+        for(i=0; i<numero_processi; i++){
+            if(pthread_create(&thread_figli[i], NULL, thread_figlio, (void *) (intptr_t) i) != 0){
+                sprintf(sprintf_buffer, "ERRORE: Creazione thread figlio n°%d\n", i+1);
+                my_write(1, sprintf_buffer);
+                
+                free_resources(buffer_comune, shmid, semid_empty, semid_full);
+                
+                exit(1);
+            }
+        }
+    }
+    
+    if(!figli_thread)
+        pid_figli = proc;
+    
+    for(i=0; i<numero_processi && !figli_thread; i++){
         proc[i] = fork();
         if(proc[i] < 0){ /* Errore */
             /**
@@ -183,16 +1263,35 @@ int main(int argc, char *argv[]){
         } else if(proc[i] == 0) { /* Figlio i */
             /** <h3>FIGLIO</h3>
              * 	Esecuzione della routine di calcolo.<br>
+             *	Chiedo al kernel di terminarmi se il padre termina (la richiesta
+             *	è mantenuta da execvp()), così che un padre ucciso non lasci figli
+             *	bloccati sui semafori e collegati alla memoria condivisa; se il
+             *	padre è già terminato prima della richiesta termino subito.
+             */
+            if(prctl(PR_SET_PDEATHSIG, SIGKILL) == -1 || getppid() != padre)
+                exit(1);
+            
+            /**
              * 	Salvo in un buffer il n° del processo corrente.
              */
             sprintf(sprintf_buffer, "%d", i);
             
+            /**
+             *	Con l'opzione -c mi fisso alla mia CPU: l'affinità è mantenuta da execvp().
+             */
+            if(n_cpu_figli > 0)
+                fissa_figlio(i);
+            
             /** Creo un vettore di argomenti contenente:
              *		- routine da eseguire
              *		- n° del processo che esegue
              * 		- n° di processori totali
+             * 		- id del segmento dei canali e identificatori dei vettori
+             * 		  di semafori empty e full
+             * 		- id, n° di risultati, presenza del vettore dei tempi e n° di
+             * 		  voci della cache dell'area di appoggio
              */
-            char *args[] = {"./routine", sprintf_buffer, n_proc, NULL};
+            char *args[] = {"./routine", sprintf_buffer, n_proc, shmid_canali, sem_empty, sem_full, shmid_appoggio, n_risultati, tempi_appoggio, voci_appoggio, NULL};
             
             /**
              * 	Eseguo la routine di calcolo per il processo figlio.<br>
@@ -215,215 +1314,181 @@ int main(int argc, char *argv[]){
     }
     
     /**  <h3>PADRE</h3>
-     *	Eseguo un ciclo di scrittura dei dati nel buffer.
+     *	In modalità streaming apro subito il file di output, su cui i
+     *	risultati vengono scritti man mano che sono raccolti.
      */
-    while(1){
-        /**
-         Salvo in una stringa la linea letta dalla funzione leggi_linea().
-         */
-        temp=leggi_linea(fd);
-        
-        /**
-         Se la stringa letta è vuota la lettura del file è terminata: interrompo
-         il ciclo e continuo l'esecuzione del programma.
-         */
-        if(strncmp(temp, "", 1) == 0)
-            break;
-        
-        /**
-         Altrimenti salvo in una struttura dati la linea appena letta tokenizata
-         con la funzione tokenize().
-         */
-        token=tokenize(temp);
-        
-        /**
-         Se l'id letto è diverso da 0
-         */
-        if(token->id_sem != 0)
-        {
-            /**
-             Devo interagire con il figlio id.<br>
-             Stampo un messaggio di notifica e salvo in una variabile il n°
-             del processo con cui dovrò interagire.
-             */
-            sprintf(sprintf_buffer, "Attendo figlio %d\n", token->id_sem);
-            my_write(1, sprintf_buffer);
-            id = token->id_sem - 1; /* Assegno a id il valore del semaforo con cui devo interagire */
-        }
-        /**
-         Se l'id letto è uguale a 0 devo scorrere tra i processi per cercare il primo
-         libero e interagirvi o attendere se tutti sono occupati.
-         */
-        else
-        {
-            /**
-             Utilizzo un contatore per scorrere tra i vari processi e controllare
-             il loro stato.
-             */
-            int id_count=0;
-            /**
-             Entro in un ciclo infinito.
-             */
-            while(1)
-            {
-                /**
-                 Se il semaforo empty del processo che sto controllando è posto a 1
-                 significa che il processo è libero: posso interrompere il ciclo e
-                 continuare l'esecuzione.
-                 */
-                if(semctl(semid_empty, id_count, GETVAL) == 1)
-                    break;
-                
-                /**
-                 Se ho raggiunto la fine del vettore di processori e non ho ancora trovato
-                 un processo libero azzero il contatore e ricomincio il controllo,
-                 altrimenti incremento il contatore e continuo la scansione del vettore.
-                 */
-                if(id_count == numero_processi - 1) {
-                    id_count = 0;
-                   	my_write(1, "Nessun processo è libero, attendo\n");
-                   	/* Simulo attesa con una sleep(). */
-                   	sleep(2);
-                } else
-                    id_count++;
-            }
-            /**
-             Quando trovo un processo libero stampo un messaggio di notifica
-             e salvo in una variabile id il n° del processore con cui devo
-             interagire.
-             */
-            sprintf(sprintf_buffer, "Figlio%d è libero\n", id_count + 1);
-            my_write(1, sprintf_buffer);
-            id = id_count;
-        }
-        
-        /**
-         Attendo che il processo id sia libero.
-         */
-        sem_wait(semid_empty, id);
-        
-        /**
-         *	Controllo se è disponibile un risultato precedente nel buffer di id,
-         * 	in tal caso salvo una stringa nell'array dei risultati, incremento il contatore dei
-         *  risultati e pongo a false la flag per permettere ulteriori
-         * 	scritture.
-         */
-        if((buffer_comune+id)->res_disponibile) {
-            array_risultati[res_count].n1 = (buffer_comune+id)->num1;
-            array_risultati[res_count].op = (buffer_comune+id)->op;
-            array_risultati[res_count].n2 = (buffer_comune+id)->num2;
-            array_risultati[res_count].res = (buffer_comune+id)->res;
-            res_count++;
-            
-            sprintf(sprintf_buffer, "\nRicevuto risultato da figlio %d\n%d/%d Operazioni svolte (%.2f%%)\n\n",
-                    id+1, res_count, row_count, (float) res_count / row_count * 100);
-            my_write(1, sprintf_buffer);
-        }
-        
-        /**
-         Scrittura dei dati appena letti nel buffer condiviso alla
-         posizione id.
-         */
-        *(buffer_comune+id)=*token;
-        
-        /**
-        	Segnalo al figlio id la presenza di operandi nel buffer.
-         */
-        sem_signal(semid_full, id);
-        
-        /**
-         Stampo un messaggio di notifica dell'avvenuta scrittura.
-         */
-        sprintf(sprintf_buffer, "Scrittura dati a figlio %d completata\n\n", id + 1);
-        my_write(1, sprintf_buffer);
-    }
+    if(streaming && !demone)
+        apri_output();
     
     /**
-     *	Lettura del file config.txt terminata: il processo padre ha letto e
+     *	Eseguo un ciclo di scrittura nei canali dei figli di tutte le
+     *	operazioni da eseguire (in modalità demone di quelle dei lavori
+     *	ricevuti dallo sportello, fino alla richiesta di arresto).
+     */
+    misure.avvio = statistiche_adesso();
+    
+    if(demone)
+        esegui_demone();
+    
+    while(!demone && (token = prossima_operazione()) != NULL)
+        esegui_operazione(token);
+    
+    /**
+     *	Lettura del file di configurazione terminata: il processo padre ha letto e
      *	inviato tutte le linee del file.<br>
      *	Entro in un ciclo che scansiona tutti i processi.
      */
     for(i=0; i<numero_processi; i++){
-        sprintf(sprintf_buffer, "Invio segnale terminazione a figlio %d\n", i + 1);
-        my_write(1, sprintf_buffer);
-        
-        /**
-         Attendo che il semaforo i-esimo abbia completato i calcoli
-         che lo tenevano occupato.
-         */
-        sem_wait(semid_empty, i);
+        LOG(LOG_FASI, "Invio segnale terminazione a figlio %d\n", i + 1);
         
         /**
-         Eventualmente salvo gli ultimi risultati.
+         Accodo nel canale del figlio il segnale di terminazione 'K' come operatore.
          */
-        if((buffer_comune+i)->res_disponibile){
-            array_risultati[res_count].n1 = (buffer_comune+i)->num1;
-            array_risultati[res_count].op = (buffer_comune+i)->op;
-            array_risultati[res_count].n2 = (buffer_comune+i)->num2;
-            array_risultati[res_count].res = (buffer_comune+i)->res;
-            res_count++;
+        terminazione.op = 'K';
+        invia_operazione(i, &terminazione);
+        pubblica_lotto(i);
+    }
+    
+    /**
+     *	Attendo che tutti i figli abbiano letto 'K' e terminato la loro esecuzione:
+     *	solo allora anche le operazioni rubate dalle code di lavoro sono state
+     *	tutte eseguite e i loro risultati salvati nell'area di appoggio.
+     *	Conto i figli terminati in modo anomalo (ucciso da un segnale o con
+     *	stato diverso da 0).
+     */
+    for(i=0; i<numero_processi; i++){
+        if(figli_thread){
+            pthread_join(thread_figli[i], &esito_figlio);
             
-            sprintf(sprintf_buffer, "\nRicevuto risultato da figlio %d\n%d/%d Operazioni svolte (%.1f%%)\n\n",
-                    i+1, res_count, row_count, (float) res_count / row_count * 100);
-            my_write(1, sprintf_buffer);
+            if(esito_figlio != NULL)
+                figli_falliti++;
+        } else if(waitpid(proc[i], &stato, 0) == -1 || !WIFEXITED(stato) || WEXITSTATUS(stato) != 0){
+            LOG(LOG_ERRORI, "ATTENZIONE: Figlio %d terminato in modo anomalo\n", i + 1);
+            figli_falliti++;
         }
-        
-        /**
-         Scrivo nel buffer il segnale di terminazione 'K' come operatore.
-         */
-        (buffer_comune+i)->op = 'K';
-        
-        /**
-         Segnalo al figlio la presenza del segnale di terminazione.
-         */
-        sem_signal(semid_full, i);
-        
-        /**
-         Attendo che il figlio i-esimo abbia letto 'K' e terminato la sua esecuzione.
-         */
-        wait(&proc[i]);
     }
     
+    res_count = __atomic_load_n(appoggio.completati, __ATOMIC_ACQUIRE) + appoggio.cache.successi;
+    misure.fine_calcoli = statistiche_adesso();
+    
+    if(streaming)
+        scrivi_risultati_pronti();
+    
     /**
      Stampo un messaggio di notifica per la terminazione dei calcoli.
      */
-    my_write(1, "**************************************************************************\n");
-    my_write(1, "Calcoli terminati\n");
+    LOG(LOG_FASI, "**************************************************************************\n");
+    LOG(LOG_FASI, "Calcoli terminati\n");
     
-    /** <h2>SCRITTURA RISULTATI</h2>
-     *	Creo un file res.txt su cui scrivere i risultati dei calcoli effettuati
-     *	dai processori.
+    /**
+     Stampo i contatori delle prestazioni di ciascun figlio.
      */
-    if((fd=creat("res.txt", 0777)) == -1){
-        my_write(1, "ERRORE: Creazione file res.txt\n");
-        exit(1);
+    for(i=0; i<numero_processi && LOG_ATTIVO(LOG_FASI); i++)
+        contatori_stampa(1, buffer_comune+i, i);
+    
+    if(appoggio.cache.voci != NULL)
+        LOG(LOG_FASI, "Cache dei risultati: %llu operazioni trovate, %llu non trovate (%.1f%% senza invio a un figlio)\n",
+            appoggio.cache.successi, appoggio.cache.fallimenti,
+            100.0 * appoggio.cache.successi / (appoggio.cache.successi + appoggio.cache.fallimenti > 0 ? appoggio.cache.successi + appoggio.cache.fallimenti : 1));
+    
+    /**
+     In modalità demone non c'è un file di output: comunico la terminazione
+     dei figli al cliente che ha richiesto l'arresto e attendo la sua
+     conferma prima di rimuovere lo sportello, così che la sua wait non
+     fallisca per la rimozione del semaforo.
+     */
+    if(demone){
+        sem_signal(sportello_demone.semid, SPORTELLO_RISPOSTA);
+        sem_wait(sportello_demone.semid, SPORTELLO_RICHIESTA);
     }
     
     /**
-     Stampo un intestazione nel file di output.
+     Verifico che tutti i risultati siano stati salvati: in modalità streaming
+     quelli non ancora scritti, altrimenti quelli di tutte le operazioni.
+     Se un figlio è terminato in modo anomalo o manca un risultato non
+     scrivo un file di output parziale e termino con un errore.
+     */
+    if(streaming)
+        mancanti = inviate - scritti;
+    else if(!demone)
+        for(i=0; i<row_count; i++)
+            mancanti += !appoggio_pronto(&appoggio, i);
+    
+    if(figli_falliti > 0 || mancanti > 0){
+        sprintf(sprintf_buffer, "ERRORE: %d figli terminati in modo anomalo, %d risultati mancanti\n", figli_falliti, mancanti);
+        my_write(1, sprintf_buffer);
+        interrompi();
+    }
+    
+    /** <h2>SCRITTURA RISULTATI</h2>
+     *	Creo il file di output su cui scrivere i risultati dei calcoli effettuati
+     *	dai processori (in modalità streaming è già stato scritto, in modalità
+     *	demone i risultati sono stati consegnati ai clienti).
      */
-    my_write(fd, "*************************\n");
-    my_write(fd, "*      RISULTATI        *\n");
-    my_write(fd, "*************************\n");
+    if(!streaming)
+        apri_output();
     
     /**
-     Entro in un ciclo per ogni risultato da scrivere salvato nell'array
-     dei risultati e scrivo sul file res.txt una stringa per ogni valore
-     calcolato preceduto da un contatore e dalla descrizione dei calcoli
-     effettuati.
+     Entro in un ciclo per ogni risultato, salvato dai figli nell'array
+     dei risultati nell'ordine dell'input, e lo accodo allo scrittore, preceduto da un contatore e
+     dalla descrizione dei calcoli effettuati (o come record nel formato
+     binario): il buffer viene scritto sul file con poche write() di grandi
+     dimensioni.
      */
-    for(i=0; i<row_count; i++){
-        sprintf(sprintf_buffer, "%d. %d %c %d = %d\n", i+1, array_risultati[i].n1, array_risultati[i].op, array_risultati[i].n2, array_risultati[i].res);
-        my_write(fd, sprintf_buffer);
+    for(i=0; i<row_count && !streaming; i++){
+        if(output_binario)
+            scrittore_record(&output, &array_risultati[i]);
+        else
+            scrittore_risultato(&output, i+1, &array_risultati[i]);
+        
+        if(appoggio.tempi != NULL)
+            istogramma_aggiungi(&misure.latenze, appoggio.tempi[i]);
+    }
+    
+    if(!demone){
+        if(scrittore_chiudi(&output) == -1){
+            sprintf(sprintf_buffer, "ERRORE: Scrittura file %s\n", file_output);
+            my_write(1, sprintf_buffer);
+        }
+        
+        if(fd != 1)
+            close(fd);
+        
+        LOG(LOG_FASI, "Scrittura risultati sul file di output '%s' terminata\n", file_output);
     }
+    LOG(LOG_FASI, "**************************************************************************\n");
     
-    my_write(1, "Scrittura risultati sul file di output 'res.txt' terminata\n");
-    my_write(1, "**************************************************************************\n");
+    /**
+     Con l'opzione -S aggiungo al file delle statistiche le misure, precedute
+     dalla descrizione della simulazione.
+     */
+    if(file_statistiche != NULL){
+        misure.fine = statistiche_adesso();
+        
+        snprintf(descrizione, sizeof(descrizione), "\"motore\":\"%s\",\"figli\":%d,\"streaming\":%s,\"lotto\":%d,\"scrittura_thread\":%s,"
+                "\"binario\":%s,\"pagine\":\"%s\",\"cpu_fissate\":%d,\"kernel\":\"%s\",\"demone\":%s,"
+                "\"cache\":%u,\"cache_trovate\":%llu,\"cache_non_trovate\":%llu",
+                figli_thread ? "thread" : "processi", numero_processi, streaming ? "true" : "false", dimensione_lotto,
+                scrittura_thread ? "true" : "false", output_binario ? "true" : "false", appoggio_descrizione(&appoggio),
+                n_cpu_figli, calcolo_kernel(), demone ? "true" : "false",
+                voci_cache, appoggio.cache.successi, appoggio.cache.fallimenti);
+        
+        if(statistiche_scrivi(&misure, file_statistiche, descrizione) == -1){
+            sprintf(sprintf_buffer, "ERRORE: Scrittura file %s\n", file_statistiche);
+            my_write(1, sprintf_buffer);
+        }
+    }
     
     /**
-    	Libero le risorse allocate con free_resources() e termino.
+    	Libero le risorse allocate con free_resources() e l'area di appoggio e termino.
      */
     free_resources(buffer_comune, shmid, semid_empty, semid_full);
+    appoggio_rilascia(&appoggio);
+    
+    if(demone)
+        sportello_rimuovi(&sportello_demone);
+    
+    istanza_termina();
     
     exit(0);
 }
\ No newline at end of file
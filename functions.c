@@ -2,8 +2,402 @@
  
 	@brief Libreria delle funzioni di utilità.
  */
+#define _GNU_SOURCE
 #include "functions.h"
 
+#include <dirent.h>
+#include <signal.h>
+#include <time.h>
+
+#ifdef USE_FUTEX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <limits.h>
+
+#define MAX_VETTORI_SEM 8	/**< N° massimo di vettori di semafori collegati per processo */
+
+/**
+	Vettori di semafori collegati dal processo: l'id restituito da sem_crea()
+	e sem_collega() è l'indice in questa tabella.
+ */
+static struct {
+    int shmid;			/* Segmento di memoria condivisa contenente i semafori */
+    semaforo* sem;		/* Indirizzo dei semafori nell'area dati del processo */
+} vettori_sem[MAX_VETTORI_SEM];
+static int n_vettori_sem = 0;	/* N° di vettori collegati */
+#endif
+
+int shmid;
+int semid_empty;
+int semid_full;
+char sprintf_buffer[128];
+int livello_log = LOG_FASI;
+
+#ifdef USE_FUTEX
+/**
+	@brief Funzione che collega un vettore di semafori alla tabella del processo
+ 
+	@param shmid Segmento contenente i semafori
+	@return Id del vettore di semafori, -1 in caso di errore
+ */
+static int collega_vettore(int shmid){
+    semaforo* sem;
+    
+    if(n_vettori_sem == MAX_VETTORI_SEM)
+        return -1;
+    
+    if((sem = (semaforo *) shmat(shmid, 0, 0666)) == (semaforo *) -1)
+        return -1;
+    
+    vettori_sem[n_vettori_sem].shmid = shmid;
+    vettori_sem[n_vettori_sem].sem = sem;
+    
+    return n_vettori_sem++;
+}
+
+/**
+ *	@brief Funzione per la creazione di un vettore di semafori
+ *
+ *	I semafori sono allocati in un segmento di memoria condivisa associato alla chiave key.
+ *	@param key Chiave del vettore di semafori
+ *	@param n N° di semafori del vettore
+ *	@param valore Valore iniziale dei semafori
+ *	@return Id del vettore di semafori, -1 in caso di errore
+ */
+int sem_crea(key_t key, int n, int valore){
+    int shmid, semid, i;
+    
+    if((shmid = shmget(key, sizeof(semaforo) * n, IPC_CREAT | IPC_EXCL | 0600)) == -1)
+        return -1;
+    
+    if((semid = collega_vettore(shmid)) == -1){
+        shmctl(shmid, IPC_RMID, NULL);
+        return -1;
+    }
+    
+    /**
+     Un vettore privato è raggiunto dai figli solo tramite l'identificatore:
+     marco subito il segmento per la rimozione, così che sparisca quando
+     l'ultimo processo collegato termina, anche in caso di errore.
+     */
+    if(key == IPC_PRIVATE)
+        shmctl(shmid, IPC_RMID, NULL);
+    
+    for(i=0; i<n; i++){
+        vettori_sem[semid].sem[i].valore = valore;
+        vettori_sem[semid].sem[i].attesa = 0;
+    }
+    
+    return semid;
+}
+
+/**
+ *	@brief Funzione per il recupero di un vettore di semafori creato da un altro processo
+ *
+ *	@param key Chiave del vettore di semafori
+ *	@param n N° di semafori del vettore
+ *	@return Id del vettore di semafori, -1 in caso di errore
+ */
+int sem_collega(key_t key, int n){
+    int shmid;
+    
+    if((shmid = shmget(key, sizeof(semaforo) * n, 0600)) == -1)
+        return -1;
+    
+    return collega_vettore(shmid);
+}
+
+/**
+ *	@brief Funzione che restituisce l'identificatore di sistema di un vettore di semafori
+ *
+ *	@param semid Id del vettore di semafori
+ *	@return Segmento di memoria condivisa contenente i semafori
+ */
+int sem_identificatore(int semid){
+    return vettori_sem[semid].shmid;
+}
+
+/**
+ *	@brief Funzione per il recupero di un vettore di semafori dal suo identificatore di sistema
+ *
+ *	@param identificatore Segmento di memoria condivisa contenente i semafori
+ *	@return Id del vettore di semafori, -1 in caso di errore
+ */
+int sem_apri(int identificatore){
+    return collega_vettore(identificatore);
+}
+
+/**
+ *	@brief Procedura che marca come rimossi i semafori di un segmento e sveglia i processi in attesa
+ *
+ *	Alza il flag rimosso e rende positivo il valore di ogni semaforo prima
+ *	di FUTEX_WAKE: un processo che sta per bloccarsi trova il valore
+ *	cambiato e non si addormenta, quindi trova il flag e termina.
+ *	@param shmid Segmento di memoria condivisa contenente i semafori
+ *	@param sem Indirizzo dei semafori nell'area dati del processo
+ */
+static void sem_chiudi(int shmid, semaforo* sem){
+    struct shmid_ds info;
+    size_t i;
+    
+    if(shmctl(shmid, IPC_STAT, &info) == -1)
+        return;
+    
+    for(i=0; i<info.shm_segsz / sizeof(semaforo); i++){
+        __atomic_store_n(&sem[i].rimosso, 1, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&sem[i].valore, INT_MAX / 2, __ATOMIC_SEQ_CST);
+        syscall(SYS_futex, &sem[i].valore, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+/**
+ *	@brief Procedura di rimozione di un vettore di semafori di un altro processo
+ *
+ *	Eventuali processi ancora bloccati sui semafori vengono svegliati.
+ *	@param identificatore Segmento di memoria condivisa contenente i semafori
+ */
+static void sem_elimina(int identificatore){
+    semaforo* sem;
+    
+    if((sem = (semaforo *) shmat(identificatore, 0, 0)) != (semaforo *) -1){
+        sem_chiudi(identificatore, sem);
+        shmdt(sem);
+    }
+    
+    shmctl(identificatore, IPC_RMID, NULL);
+}
+
+/**
+ *	@brief Procedura per la rimozione di un vettore di semafori
+ *
+ *	Eventuali processi ancora bloccati sui semafori vengono svegliati.
+ *	@param semid Id del vettore di semafori
+ */
+void sem_rimuovi(int semid){
+    sem_chiudi(vettori_sem[semid].shmid, vettori_sem[semid].sem);
+    shmctl(vettori_sem[semid].shmid, IPC_RMID, NULL);
+    shmdt(vettori_sem[semid].sem);
+}
+
+/**
+ *	@brief Funzione per la lettura del valore di un semaforo
+ *
+ *  @param semid Id del vettore di semafori
+ *	@param num N° del semaforo
+ *	@return Valore corrente del semaforo
+ */
+int sem_valore(int semid, int num){
+    return __atomic_load_n(&vettori_sem[semid].sem[num].valore, __ATOMIC_SEQ_CST);
+}
+
+/**
+ *	@brief Funzione per l'esecuzione di una wait non bloccante su un semaforo
+ *
+ *	Decrementa atomicamente il valore del semaforo indicato se positivo.
+ *	Se il vettore è stato rimosso termina con un errore, come semop().
+ *  @param semid Id del vettore di semafori
+ *	@param num N° del semaforo su cui eseguire l'operazione
+ *	@return true se il semaforo è stato decrementato, false altrimenti
+ */
+bool sem_trywait(int semid, int num){
+    semaforo* s = &vettori_sem[semid].sem[num];
+    int v;
+    
+    if(__atomic_load_n(&s->rimosso, __ATOMIC_SEQ_CST)){
+        sprintf(sprintf_buffer, "ERRORE: Esecuzione wait su semaforo n°%d\n", num);
+        my_write(1, sprintf_buffer);
+        exit(1);
+    }
+    
+    v = __atomic_load_n(&s->valore, __ATOMIC_RELAXED);
+    
+    while(v > 0){
+        if(__atomic_compare_exchange_n(&s->valore, &v, v - 1, true, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            return true;
+    }
+    
+    return false;
+}
+
+/**
+ *	@brief Procedura per l'esecuzione di una wait su un semaforo
+ *
+ *	Se il semaforo è positivo lo decrementa senza entrare nel kernel,
+ *	altrimenti si registra tra i processi in attesa e si blocca con
+ *	FUTEX_WAIT finchè il valore resta 0.
+ *  @param semid Id del vettore di semafori
+ *	@param num N° del semaforo su cui eseguire l'operazione
+ */
+void sem_wait(int semid, int num){
+    semaforo* s = &vettori_sem[semid].sem[num];
+    
+    while(!sem_trywait(semid, num)){
+        __atomic_fetch_add(&s->attesa, 1, __ATOMIC_SEQ_CST);
+        
+        if(syscall(SYS_futex, &s->valore, FUTEX_WAIT, 0, NULL, NULL, 0) == -1 && errno != EAGAIN && errno != EINTR){
+            sprintf(sprintf_buffer, "ERRORE: Esecuzione wait su semaforo n°%d\n", num);
+            my_write(1, sprintf_buffer);
+            exit(1);
+        }
+        
+        __atomic_fetch_sub(&s->attesa, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+/**
+ *	@brief Funzione per l'esecuzione di una wait con tempo massimo su un semaforo
+ *
+ *	Come sem_wait(), ma FUTEX_WAIT riceve il tempo che resta fino alla
+ *	scadenza, calcolata sull'orologio monotono.
+ *  @param semid Id del vettore di semafori
+ *	@param num N° del semaforo su cui eseguire l'operazione
+ *	@param millisecondi Tempo massimo di attesa (ms)
+ *	@return true se il semaforo è stato decrementato, false se il tempo è scaduto
+ */
+bool sem_timedwait(int semid, int num, int millisecondi){
+    semaforo* s = &vettori_sem[semid].sem[num];
+    struct timespec scadenza, ora, resto;
+    
+    clock_gettime(CLOCK_MONOTONIC, &scadenza);
+    scadenza.tv_sec += millisecondi / 1000;
+    scadenza.tv_nsec += (millisecondi % 1000) * 1000000L;
+    if(scadenza.tv_nsec >= 1000000000L){
+        scadenza.tv_sec++;
+        scadenza.tv_nsec -= 1000000000L;
+    }
+    
+    while(!sem_trywait(semid, num)){
+        clock_gettime(CLOCK_MONOTONIC, &ora);
+        resto.tv_sec = scadenza.tv_sec - ora.tv_sec;
+        resto.tv_nsec = scadenza.tv_nsec - ora.tv_nsec;
+        if(resto.tv_nsec < 0){
+            resto.tv_sec--;
+            resto.tv_nsec += 1000000000L;
+        }
+        
+        if(resto.tv_sec < 0)
+            return false;
+        
+        __atomic_fetch_add(&s->attesa, 1, __ATOMIC_SEQ_CST);
+        
+        if(syscall(SYS_futex, &s->valore, FUTEX_WAIT, 0, &resto, NULL, 0) == -1 && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT){
+            sprintf(sprintf_buffer, "ERRORE: Esecuzione wait su semaforo n°%d\n", num);
+            my_write(1, sprintf_buffer);
+            exit(1);
+        }
+        
+        __atomic_fetch_sub(&s->attesa, 1, __ATOMIC_SEQ_CST);
+    }
+    
+    return true;
+}
+
+/**
+ *	@brief Procedura per l'esecuzione di una signal su un semaforo
+ *
+ *	Incrementa atomicamente il valore del semaforo e chiama FUTEX_WAKE
+ *	solo se c'è almeno un processo in attesa.
+ *  @param semid Id del vettore di semafori
+ *	@param num N° del semaforo su cui eseguire l'operazione
+ */
+void sem_signal(int semid, int num){
+    semaforo* s = &vettori_sem[semid].sem[num];
+    
+    __atomic_fetch_add(&s->valore, 1, __ATOMIC_SEQ_CST);
+    
+    if(__atomic_load_n(&s->attesa, __ATOMIC_SEQ_CST) > 0)
+        syscall(SYS_futex, &s->valore, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+#else
+/**
+ *	@brief Funzione per la creazione di un vettore di semafori
+ *
+ *	Crea in modo esclusivo un vettore di n semafori associato alla chiave key
+ *	e li inizializza al valore indicato.
+ *	@param key Chiave del vettore di semafori
+ *	@param n N° di semafori del vettore
+ *	@param valore Valore iniziale dei semafori
+ *	@return Id del vettore di semafori, -1 in caso di errore
+ */
+int sem_crea(key_t key, int n, int valore){
+    int semid, i;
+    
+    if((semid = semget(key, n, IPC_CREAT | IPC_EXCL | 0600)) == -1)
+        return -1;
+    
+    for(i=0; i<n; i++){
+        if(semctl(semid, i, SETVAL, valore) == -1){
+            semctl(semid, 0, IPC_RMID);
+            return -1;
+        }
+    }
+    
+    return semid;
+}
+
+/**
+ *	@brief Funzione per il recupero di un vettore di semafori creato da un altro processo
+ *
+ *	@param key Chiave del vettore di semafori
+ *	@param n N° di semafori del vettore
+ *	@return Id del vettore di semafori, -1 in caso di errore
+ */
+int sem_collega(key_t key, int n){
+    return semget(key, n, 0600);
+}
+
+/**
+ *	@brief Funzione che restituisce l'identificatore di sistema di un vettore di semafori
+ *
+ *	@param semid Id del vettore di semafori
+ *	@return Id System V del vettore, valido in ogni processo
+ */
+int sem_identificatore(int semid){
+    return semid;
+}
+
+/**
+ *	@brief Funzione per il recupero di un vettore di semafori dal suo identificatore di sistema
+ *
+ *	Verifica che il vettore esista ancora.
+ *	@param identificatore Id System V del vettore
+ *	@return Id del vettore di semafori, -1 in caso di errore
+ */
+int sem_apri(int identificatore){
+    struct semid_ds info;
+    
+    return semctl(identificatore, 0, IPC_STAT, &info) == -1 ? -1 : identificatore;
+}
+
+/**
+ *	@brief Procedura di rimozione di un vettore di semafori di un altro processo
+ *
+ *	@param identificatore Id System V del vettore
+ */
+static void sem_elimina(int identificatore){
+    semctl(identificatore, 0, IPC_RMID);
+}
+
+/**
+ *	@brief Procedura per la rimozione di un vettore di semafori
+ *
+ *	@param semid Id del vettore di semafori
+ */
+void sem_rimuovi(int semid){
+    semctl(semid, 0, IPC_RMID);
+}
+
+/**
+ *	@brief Funzione per la lettura del valore di un semaforo
+ *
+ *  @param semid Id del vettore di semafori
+ *	@param num N° del semaforo
+ *	@return Valore corrente del semaforo
+ */
+int sem_valore(int semid, int num){
+    return semctl(semid, num, GETVAL);
+}
+
 /**
  *	@brief Procedura per l'esecuzione di una wait su un semaforo
  *
@@ -13,15 +407,63 @@
  *	@param num N° del semaforo su cui eseguire l'operazione
  */
 void sem_wait(int semid, int num){
-    wait_b.sem_num = num;
-    wait_b.sem_op = -1;
-    wait_b.sem_flg = 0;
+    struct sembuf wait_b = { .sem_num = num, .sem_op = -1, .sem_flg = 0 };	/* Operazione wait, locale perchè padre e figli thread la eseguono in parallelo */
+    
+    if(semop(semid, &wait_b, 1) == -1){
+        sprintf(sprintf_buffer, "ERRORE: Esecuzione wait su semaforo n°%d\n", num);
+        my_write(1, sprintf_buffer);
+        exit(1);
+    }
+}
+
+/**
+ *	@brief Funzione per l'esecuzione di una wait non bloccante su un semaforo
+ *
+ *	Decrementa il valore del semaforo indicato se positivo, altrimenti
+ *	ritorna immediatamente senza bloccarsi.
+ *  @param semid Id del vettore di semafori
+ *	@param num N° del semaforo su cui eseguire l'operazione
+ *	@return true se il semaforo è stato decrementato, false altrimenti
+ */
+bool sem_trywait(int semid, int num){
+    struct sembuf wait_b = { .sem_num = num, .sem_op = -1, .sem_flg = IPC_NOWAIT };	/* Operazione wait non bloccante */
     
     if(semop(semid, &wait_b, 1) == -1){
+        if(errno == EAGAIN)
+            return false;
+        
+        sprintf(sprintf_buffer, "ERRORE: Esecuzione wait su semaforo n°%d\n", num);
+        my_write(1, sprintf_buffer);
+        exit(1);
+    }
+    
+    return true;
+}
+
+/**
+ *	@brief Funzione per l'esecuzione di una wait con tempo massimo su un semaforo
+ *
+ *	Esegue la wait con semtimedop(), che fallisce con EAGAIN allo scadere
+ *	del tempo.
+ *  @param semid Id del vettore di semafori
+ *	@param num N° del semaforo su cui eseguire l'operazione
+ *	@param millisecondi Tempo massimo di attesa (ms)
+ *	@return true se il semaforo è stato decrementato, false se il tempo è scaduto
+ */
+bool sem_timedwait(int semid, int num, int millisecondi){
+    struct sembuf wait_b = { .sem_num = num, .sem_op = -1, .sem_flg = 0 };	/* Operazione wait */
+    struct timespec tempo = { .tv_sec = millisecondi / 1000, .tv_nsec = (millisecondi % 1000) * 1000000L };
+    
+    if(semtimedop(semid, &wait_b, 1, &tempo) == -1){
+        if(errno == EAGAIN)
+            return false;
+        
         sprintf(sprintf_buffer, "ERRORE: Esecuzione wait su semaforo n°%d\n", num);
         my_write(1, sprintf_buffer);
         exit(1);
     }
+    
+    return true;
 }
 
 /**
@@ -32,9 +474,7 @@ void sem_wait(int semid, int num){
  *	@param num N° del semaforo su cui eseguire l'operazione
  */
 void sem_signal(int semid, int num){
-    signal_b.sem_num = num;
-    signal_b.sem_op = 1;
-    signal_b.sem_flg = 0;
+    struct sembuf signal_b = { .sem_num = num, .sem_op = 1, .sem_flg = 0 };	/* Operazione signal */
     
     if(semop(semid, &signal_b, 1) == -1){
         sprintf(sprintf_buffer, "ERRORE: Esecuzione signal su semaforo n°%d\n", num);
@@ -43,122 +483,220 @@ void sem_signal(int semid, int num){
     }
 }
 
+#endif
+
 /**
-	@brief Funzione per la lettura di una linea del file fd.
- 
-	@param fd File descriptor del file su cui effettuare la lettura.
-	@return Stringa contenente l'ultima riga letta.
+ *  @brief Funzione per la stampa di un messaggio a video.
+ *
+ *  Chiama la funzione write per eseguire la stampa su STDOUT (fd = 1) o sul file fd.<br>
+ *	La lunghezza della stringa è ricavata con la funzione strlen() della libreria string.h.
+ *	@param fd File descriptor del file su cui scrivere.
+ *  @param msg Stringa contenente il messaggio da stampare a video.
  */
-char* leggi_linea(int fd){
-    char* res;	/* Stringa per il salvataggio dei caratteri letti dal buffer */
-    char c;	 	/* Buffer per la lettura del file carattere per carattere */
-    int i=0;	/* Contatore */
-    
-    /**
-     Alloco lo spazio per la stringa risultato (Max. 128 char).
-     */
-    res = (char *) malloc(sizeof(char)*128);
+void my_write(int fd, char* msg){
+    write(fd, msg, strlen(msg));
+}
+
+/**
+	@brief Procedura per l'inizializzazione del livello di log
+
+	Legge il livello dalla variabile d'ambiente LOG_ENV, se presente e valida.
+ */
+void log_inizializza(void){
+    char* valore = getenv(LOG_ENV);
     
+    if(valore != NULL && valore[0] >= '0' && valore[0] <= '0' + LOG_OPERAZIONI && valore[1] == '\0')
+        livello_log = valore[0] - '0';
+}
+
+/**
+	@brief Funzione che libera lo spazio allocato alle risorse create
+ 
+	@param buffer Struttura dati condivisa
+	@param shmid Identificatore della memoria condivisa (-1 se i canali sono in memoria privata)
+	@param semid_e Identificatore del vettore di semafori empty
+	@param semid_f Identificatore del vettore di semafori full
+ */
+void free_resources(void* buffer, int shmid, int semid_e, int semid_f){
     /**
-     Entro in un ciclo di lettura finchè ci sono caratteri da leggere.
+     Con i figli eseguiti come thread i canali non sono in un segmento
+     condiviso (shmid = -1).
      */
-    while(read(fd, &c, 1) > 0){
-        /**
-         Se il carattere letto è '\n' ho raggiunto la fine della linea.
-         Posso terminare il ciclo.
-         */
-        if(c == '\n')
-            break;
+    if(shmid != -1){
+        shmdt(buffer);
         
-        /**
-         Altrimenti aggiungo nella posizione i-esima di res il carattere
-         letto e incremento il contatore.
-         */
-        *(res+i) = c;
-        i++;
+        shmctl(shmid, IPC_RMID, NULL);
+    } else {
+        free(buffer);
     }
     
-    /**
-     Aggiungo il carattere di terminazione alla fine di res.
-     */
-    *(res+i+1) = '\0';
+    sem_rimuovi(semid_e);
     
-    return res;
+    sem_rimuovi(semid_f);
 }
 
 /**
-	@brief Funzione che esegue la divisione in token di una stringa
-	passata come parametro.
- 
-	@param line Stringa letta dalla funzione leggi_linea dal file di configurazione
-	che deve essere tokenizzata.
-	@return Struttura dati contenente le variabili da passare alla routine del
-	processo figlio per l'esecuzione dei calcoli.
+	@brief Procedura che compone il percorso del file dell'istanza con il pid indicato
+ */
+static void percorso_istanza(char* percorso, size_t n, long pid){
+    snprintf(percorso, n, ISTANZE_DIR "/" ISTANZE_PREFISSO "%ld", pid);
+}
+
+/**
+	@brief Funzione che verifica se il processo pid è ancora in esecuzione
+
+	Un processo terminato ma non ancora atteso dal padre (zombie) non è in
+	esecuzione, anche se kill() lo trova ancora.
+	@param pid Pid del processo
+	@return true se il processo è in esecuzione
  */
-dati* tokenize(char* line){
-    dati* res;				/* Struttura dati dove salvare i valori letti da ritornare. */
-    int i=0;				/* Contatore */
-    int token[4];			/* Vettore contenente i token interi letti dalla funzione strtok */
-    char c;					/* Carattere contenente l'operatore letto dalla funzione strtok */
+bool processo_attivo(pid_t pid){
+    char percorso[64], stato[256], *p;
+    int fd;
+    ssize_t letti;
     
-    /**
-     Alloco lo spazio per la struttura dati res.
-     */
-    res = (dati *) malloc(sizeof(dati));
+    if(kill(pid, 0) == -1 && errno == ESRCH)
+        return false;
     
     /**
-     Inizio un ciclo di lettura dei token tramite la funzione strtok().
-     La funzione riceve come parametro la stringa da leggere e il carattere
-     separatore come divisore tra i vari token.
+     Lo stato è il campo che segue il nome del comando, tra parentesi, in /proc/pid/stat.
      */
-    token[i++] = atoi(strtok(line, " "));
-    
-    while(i < 4){
-        if(i == 2) {
-            c = strtok(NULL, " ")[0];
-            i++;
-        } else {
-            token[i++] = atoi(strtok(NULL, " "));
+    snprintf(percorso, sizeof(percorso), "/proc/%ld/stat", (long) pid);
+    if((fd = open(percorso, O_RDONLY)) == -1)
+        return true;
+    
+    letti = read(fd, stato, sizeof(stato) - 1);
+    close(fd);
+    
+    if(letti <= 0)
+        return true;
+    
+    stato[letti] = '\0';
+    
+    return (p = strrchr(stato, ')')) == NULL || p[1] != ' ' || (p[2] != 'Z' && p[2] != 'X');
+}
+
+/**
+	@brief Funzione che annota un oggetto IPC nel file dell'istanza corrente
+
+	Gli identificatori di sistema includono un n° di sequenza incrementato a
+	ogni riutilizzo della posizione nella tabella del kernel: un identificatore
+	annotato non può indicare un oggetto creato in seguito da un'altra istanza.
+	@param tipo Tipo di oggetto (ISTANZA_SEMAFORI o ISTANZA_MEMORIA)
+	@param id Identificatore di sistema dell'oggetto
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int istanza_registra(char tipo, int id){
+    char percorso[64], riga[32];
+    int fd, n, esito;
+    
+    percorso_istanza(percorso, sizeof(percorso), (long) getpid());
+    
+    if((fd = open(percorso, O_WRONLY | O_CREAT | O_APPEND, 0600)) == -1)
+        return -1;
+    
+    n = sprintf(riga, "%c %d\n", tipo, id);
+    esito = write(fd, riga, n) == n ? 0 : -1;
+    close(fd);
+    
+    return esito;
+}
+
+/**
+	@brief Procedura di rimozione degli oggetti IPC delle istanze terminate
+
+	Scorre i file delle istanze in ISTANZE_DIR e, per ogni istanza il cui
+	processo non esiste più, rimuove gli oggetti annotati e il file.
+	Le istanze di altri utenti (kill() fallisce con EPERM) sono ignorate.
+ */
+void istanza_pulisci(void){
+    DIR* dir;
+    struct dirent* voce;
+    FILE* file;
+    char percorso[64], tipo;
+    int id, rimossi;
+    long pid;
+    size_t prefisso = strlen(ISTANZE_PREFISSO);
+    
+    if((dir = opendir(ISTANZE_DIR)) == NULL)
+        return;
+    
+    while((voce = readdir(dir)) != NULL){
+        if(strncmp(voce->d_name, ISTANZE_PREFISSO, prefisso) != 0)
+            continue;
+        
+        pid = atol(voce->d_name + prefisso);
+        if(pid <= 0 || processo_attivo((pid_t) pid))
+            continue;
+        
+        percorso_istanza(percorso, sizeof(percorso), pid);
+        if((file = fopen(percorso, "r")) == NULL)
+            continue;
+        
+        for(rimossi=0; fscanf(file, " %c %d", &tipo, &id) == 2; rimossi++){
+            if(tipo == ISTANZA_SEMAFORI)
+                sem_elimina(id);
+            else
+                shmctl(id, IPC_RMID, NULL);
         }
+        
+        fclose(file);
+        unlink(percorso);
+        
+        LOG(LOG_FASI, "Rimossi %d oggetti IPC dell'istanza terminata %ld\n", rimossi, pid);
     }
     
-    /**
-     Salvo gli argomenti da ritornare nella struttura res.
-     */
-    res->id_sem = token[0];
-    res->num1 = token[1];
-    res->op = c;
-    res->num2 = token[3];
+    closedir(dir);
+}
+
+/**
+	@brief Procedura di rimozione del file dell'istanza corrente
+
+	Da chiamare dopo aver liberato le risorse annotate.
+ */
+void istanza_termina(void){
+    char percorso[64];
     
-    return res;
+    percorso_istanza(percorso, sizeof(percorso), (long) getpid());
+    unlink(percorso);
 }
 
 /**
- *  @brief Funzione per la stampa di un messaggio a video.
+ *	@brief Funzione che calcola la dimensione del segmento di memoria condivisa
  *
- *  Chiama la funzione write per eseguire la stampa su STDOUT (fd = 1) o sul file fd.<br>
- *	La lunghezza della stringa è ricavata con la funzione strlen() della libreria string.h.
- *	@param fd File descriptor del file su cui scrivere.
- *  @param msg Stringa contenente il messaggio da stampare a video.
+ *	@param n N° di processi figli
+ *	@return Dimensione in byte del segmento (canali dei figli)
  */
-void my_write(int fd, char* msg){
-    write(fd, msg, strlen(msg));
+size_t dimensione_segmento(int n){
+    return sizeof(canale) * n;
 }
 
 /**
-	@brief Funzione che libera lo spazio allocato alle risorse create
- 
-	@param buffer Struttura dati condivisa
-	@param shmid Identificatore della memoria condivisa
-	@param semid_e Identificatore del vettore di semafori empty
-	@param semid_f Identificatore del vettore di semafori full
+ *	@brief Procedura per la stampa dei contatori delle prestazioni di un figlio
+ *
+ *	Stampa su due righe le operazioni eseguite, i tempi di lavoro e di attesa
+ *	di figlio e padre con il 99° percentile delle attese, il n° di operazioni
+ *	pubblicate e non ancora eseguite e la profondità massima raggiunta.<br>
+ *	I contatori possono essere letti mentre il figlio li aggiorna: i valori
+ *	stampati durante l'esecuzione sono indicativi.
+ *	@param fd File descriptor su cui stampare
+ *	@param ch Canale del figlio
+ *	@param id N° del figlio
  */
-void free_resources(dati* buffer, int shmid, int semid_e, int semid_f){
-    shmdt(buffer);
+void contatori_stampa(int fd, const canale* ch, int id){
+    char riga[256];
+    unsigned int in_attesa = __atomic_load_n(&ch->coda, __ATOMIC_RELAXED) - __atomic_load_n(&ch->testa, __ATOMIC_RELAXED)
+                           + __atomic_load_n(&ch->lavoro.coda, __ATOMIC_RELAXED) - __atomic_load_n(&ch->lavoro.testa, __ATOMIC_RELAXED);
     
-    shmctl(shmid, IPC_RMID, NULL);
+    snprintf(riga, sizeof(riga), "Figlio %d: %lld operazioni (%lld rubate) in %lld lotti, lavoro %.3f ms, "
+             "attesa %.3f ms (%lld attese, p99 %lld us)\n",
+             id + 1, ch->figlio.operazioni, ch->figlio.rubate, ch->figlio.lotti, ch->figlio.lavoro_ns / 1e6,
+             ch->figlio.attesa_ns / 1e6, ch->figlio.attese.n, istogramma_percentile(&ch->figlio.attese, 99) / 1000);
+    my_write(fd, riga);
     
-    semctl(semid_e, 0, IPC_RMID);
-    
-    semctl(semid_f, 0, IPC_RMID);
-}
\ No newline at end of file
+    snprintf(riga, sizeof(riga), "          padre in attesa %.3f ms (%lld attese, p99 %lld us), "
+             "%u operazioni in coda, profondità massima %u\n",
+             ch->padre.attesa_ns / 1e6, ch->padre.attese.n, istogramma_percentile(&ch->padre.attese, 99) / 1000,
+             in_attesa, ch->padre.profondita_massima);
+    my_write(fd, riga);
+}
@@ -2,7 +2,16 @@
  
 	@brief Libreria delle funzioni di utilità.
  
-	Contiene le definizioni per la libreria functions.
+	Contiene le definizioni per la libreria functions.<br>
+	I vettori di semafori sono implementati con i semafori System V oppure,
+	compilando con USE_FUTEX (make SYNC=futex), con contatori atomici in
+	memoria condivisa che entrano nel kernel tramite futex solo in caso di attesa.<br>
+	Ogni esecuzione di elab2 crea i propri oggetti IPC con IPC_PRIVATE e ne
+	passa gli identificatori ai figli, così che più istanze possano essere
+	eseguite contemporaneamente. Gli oggetti che sopravvivono al processo
+	(i semafori System V e lo sportello del demone) sono annotati nel file
+	dell'istanza ISTANZE_DIR/ISTANZE_PREFISSO<pid>: all'avvio elab2 rimuove
+	gli oggetti delle istanze il cui processo non esiste più.
  */
 
 #ifndef FUNCTIONS_H
@@ -17,17 +26,78 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <stddef.h>
 
-#define SHMKEY 75 	/**< Chiave del buffer condiviso */
-#define EMPTYKEY 65	/**< Chiave del vettore di semafori empty */
-#define FULLKEY 66 	/**< Chiave del vettore di semafori full */
+#include "istogramma.h"
 
-struct sembuf wait_b;	/**< Struttura dati per l'esecuzione dell'operazione wait su un semaforo */
-struct sembuf signal_b;	/**< Struttura dati per l'esecuzione dell'operazione signal su un semaforo */
-int shmid;				/**< Identificatore della memoria condivisa */
-int semid_empty; 		/**< Identificatore del vettore di semafori empty */
-int semid_full;			/**< Identificatore del vettore di semafori full */
-char sprintf_buffer[128];/**< Buffer per la chiamata a funzione sprintf().*/
+#define ISTANZE_DIR "/tmp"				/**< Directory dei file delle istanze di elab2 */
+#define ISTANZE_PREFISSO "elab2-ipc."	/**< Prefisso del file di un'istanza, seguito dal pid */
+#define ISTANZA_SEMAFORI 'S'			/**< Tipo di oggetto di un'istanza: vettore di semafori */
+#define ISTANZA_MEMORIA 'M'				/**< Tipo di oggetto di un'istanza: segmento di memoria condivisa */
+
+#define LINEA_CACHE 64	/**< Dimensione di una linea di cache */
+
+#ifdef USE_FUTEX
+/**
+	Semaforo contatore implementato in memoria condivisa.<br>
+	Wait e signal operano con istruzioni atomiche su valore e chiamano la
+	system call futex solo se il semaforo è a 0 (wait) o se ci sono processi
+	in attesa (signal).<br>
+	Ogni semaforo occupa una linea di cache, così che i semafori di figli
+	diversi dello stesso vettore non condividano la linea.
+ */
+typedef struct __attribute__((aligned(LINEA_CACHE))) semaforo {
+    int valore;		/**< Valore del semaforo */
+    int attesa;		/**< N° di processi bloccati (o in procinto di bloccarsi) sul semaforo */
+    int rimosso;	/**< Flag: vettore rimosso, le wait terminano con un errore */
+} semaforo;
+
+_Static_assert(sizeof(semaforo) == LINEA_CACHE, "un semaforo per linea di cache");
+#endif
+
+#define CAPACITA_CANALE 64	/**< N° di operazioni accodabili a ciascun figlio (potenza di 2) */
+#define DIMENSIONE_PAGINA 4096	/**< Allineamento dei canali, così che ciascuno occupi pagine proprie */
+
+extern int shmid;				/**< Identificatore della memoria condivisa */
+extern int semid_empty; 		/**< Identificatore del vettore di semafori empty */
+extern int semid_full;			/**< Identificatore del vettore di semafori full */
+extern char sprintf_buffer[128];/**< Buffer per la chiamata a funzione sprintf().*/
+extern int livello_log;			/**< Livello dei messaggi stampati a video (LOG_ERRORI, LOG_FASI, LOG_OPERAZIONI) */
+
+#define LOG_ERRORI 0		/**< Livello di log: solo messaggi di errore */
+#define LOG_FASI 1			/**< Livello di log: fasi della simulazione (default) */
+#define LOG_OPERAZIONI 2	/**< Livello di log: un messaggio per ogni operazione */
+#define LOG_ENV "ELAB2_LOG"	/**< Variabile d'ambiente contenente il livello di log, ereditata dai figli */
+
+/**
+	Livello massimo di log compilato: con -DNO_LOG i messaggi per operazione
+	sono eliminati a tempo di compilazione.
+ */
+#ifdef NO_LOG
+#define LOG_MASSIMO LOG_FASI
+#else
+#define LOG_MASSIMO LOG_OPERAZIONI
+#endif
+
+/**
+	Condizione vera se i messaggi di livello l vanno stampati.
+ */
+#define LOG_ATTIVO(l) ((l) <= LOG_MASSIMO && (l) <= livello_log)
+
+/**
+	Stampa a video un messaggio formattato se il livello l è attivo.<br>
+	Usa un buffer locale e non sprintf_buffer, così da poter essere chiamata
+	anche dai figli eseguiti come thread.
+ */
+#define LOG(l, ...) do { \
+        if(LOG_ATTIVO(l)){ \
+            char messaggio_log[256]; \
+            snprintf(messaggio_log, sizeof(messaggio_log), __VA_ARGS__); \
+            my_write(1, messaggio_log); \
+        } \
+    } while(0)
 
 /**
 	Struttura dati utilizzata nella comunicazione tra padre e figli
@@ -38,7 +108,8 @@ typedef struct operazione {
     char op; 				/**< Operatore:<br> + somma<br> - differenza<br> * prodotto<br> / divisione<br> */
     int num2; 				/**< Secondo operando */
     int res;				/**< Risultato calcolato dal processo figlio */
-    bool res_disponibile;	/**< Flag che indica la presenza o meno di risultati da trascrivere al padre */
+    unsigned int indice;	/**< N° di sequenza dell'operazione nell'input */
+    bool res_disponibile;	/**< Flag che indica che l'operazione di una coda di lavoro è stata eseguita */
 } dati;
 
 /**
@@ -51,6 +122,161 @@ typedef struct risultati{
     int res;		/**< Risultato */
 } res;
 
+/**
+	Coda di lavoro di un figlio per le operazioni con id 0, nella memoria
+	condivisa.<br>
+	Il padre è l'unico produttore: scrive le operazioni negli slot e avanza
+	coda. Le operazioni vengono prelevate dalla testa sia dal figlio
+	proprietario sia dai figli inattivi che le rubano, riservandole con una
+	compare-and-swap su testa; chi esegue un'operazione ne salva il risultato
+	nell'area di appoggio e alza res_disponibile.<br>
+	Il padre libera gli slot in ordine a partire dall'ultimo liberato,
+	fermandosi al primo slot non ancora eseguito.<br>
+	testa, coda e slot sono su linee di cache distinte.
+ */
+typedef struct coda_lavoro {
+    unsigned int testa __attribute__((aligned(LINEA_CACHE)));	/**< Indice della prossima operazione da prelevare (CAS dei figli) */
+    unsigned int coda __attribute__((aligned(LINEA_CACHE)));	/**< Indice del prossimo slot da scrivere (scritto dal padre) */
+    dati slot[CAPACITA_CANALE] __attribute__((aligned(LINEA_CACHE)));	/**< Operazioni accodate e relativi risultati */
+} coda_lavoro;
+
+/**
+	Contatori delle prestazioni di un figlio, aggiornati solo dal figlio.<br>
+	Il tempo di lavoro è misurato per lotto (una lettura dell'orologio prima e
+	una dopo i calcoli), quello di attesa solo quando il figlio si blocca.
+ */
+typedef struct contatori_figlio {
+    long long operazioni;		/**< N° di operazioni eseguite */
+    long long rubate;			/**< N° di operazioni rubate alle code di lavoro degli altri figli */
+    long long lotti;			/**< N° di lotti eseguiti */
+    long long lavoro_ns;		/**< Tempo speso a eseguire i lotti (ns) */
+    long long attesa_ns;		/**< Tempo bloccato sul semaforo full (ns) */
+    istogramma attese;			/**< Durate delle attese sul semaforo full (ns) */
+} contatori_figlio;
+
+/**
+	Contatori delle interazioni del padre con un figlio, aggiornati solo dal padre.
+ */
+typedef struct contatori_padre {
+    long long attesa_ns;		/**< Tempo bloccato sul semaforo empty del figlio (ns) */
+    unsigned int profondita_massima;	/**< N° massimo di slot occupati nel canale e nella coda di lavoro alla pubblicazione */
+    istogramma attese;			/**< Durate delle attese sul semaforo empty del figlio (ns) */
+} contatori_padre;
+
+/**
+	Canale di comunicazione tra il padre e un figlio: coda circolare
+	single-producer/single-consumer di operazioni nella memoria condivisa.<br>
+	Il padre scrive le operazioni negli slot e avanza coda, il figlio le
+	esegue, ne salva il risultato nell'area di appoggio e avanza testa,
+	liberando gli slot.<br>
+	Il canale contiene anche la coda di lavoro del figlio per le operazioni
+	con id 0, che possono essere eseguite anche da altri figli.<br>
+	I semafori empty e full sono usati solo quando una delle due parti deve
+	bloccarsi (coda piena o vuota), segnalandolo con le flag padre_attende
+	e figlio_attende.<br>
+	Ogni canale è allineato alla pagina, così da poter essere spostato sul
+	nodo NUMA del figlio senza coinvolgere i canali degli altri figli.<br>
+	All'interno del canale i campi scritti dal figlio (testa, figlio_attende),
+	quelli scritti dal padre (coda, padre_attende) e gli slot sono su linee
+	di cache distinte, così che padre e figlio non si contendano la stessa
+	linea a ogni pubblicazione.<br>
+	In coda al canale si trovano i contatori delle prestazioni del figlio e
+	del padre, ciascuno scritto da una sola parte, stampati al termine da
+	elab2 e leggibili durante l'esecuzione con ipcstat.
+ */
+typedef struct __attribute__((aligned(DIMENSIONE_PAGINA))) canale {
+    unsigned int testa __attribute__((aligned(LINEA_CACHE)));	/**< Indice della prossima operazione da eseguire (scritto dal figlio) */
+    int figlio_attende;				/**< Flag: il figlio sta per bloccarsi sul semaforo full */
+    unsigned int coda __attribute__((aligned(LINEA_CACHE)));	/**< Indice del prossimo slot da scrivere (scritto dal padre) */
+    int padre_attende;				/**< Flag: il padre sta per bloccarsi sul semaforo empty */
+    dati slot[CAPACITA_CANALE] __attribute__((aligned(LINEA_CACHE)));	/**< Operazioni accodate al figlio e relativi risultati */
+    coda_lavoro lavoro;				/**< Operazioni con id 0 assegnate al figlio */
+    contatori_figlio figlio __attribute__((aligned(LINEA_CACHE)));	/**< Contatori delle prestazioni del figlio */
+    contatori_padre padre __attribute__((aligned(LINEA_CACHE)));	/**< Contatori delle interazioni del padre con il figlio */
+} canale;
+
+_Static_assert(offsetof(canale, coda) - offsetof(canale, testa) == LINEA_CACHE, "testa e coda del canale su linee distinte");
+_Static_assert(offsetof(canale, slot) % LINEA_CACHE == 0, "slot del canale allineati alla linea");
+_Static_assert(offsetof(coda_lavoro, coda) - offsetof(coda_lavoro, testa) == LINEA_CACHE, "testa e coda della coda di lavoro su linee distinte");
+_Static_assert(offsetof(canale, lavoro) % LINEA_CACHE == 0, "coda di lavoro allineata alla linea");
+_Static_assert(sizeof(canale) % DIMENSIONE_PAGINA == 0, "canali su pagine distinte");
+
+/**
+ *	@brief Funzione che calcola la dimensione del segmento di memoria condivisa
+ *
+ *	@param n N° di processi figli
+ *	@return Dimensione in byte del segmento (canali dei figli)
+ */
+size_t dimensione_segmento(int n);
+
+/**
+ *	@brief Procedura per la stampa dei contatori delle prestazioni di un figlio
+ *
+ *	Stampa su due righe le operazioni eseguite, i tempi di lavoro e di attesa
+ *	di figlio e padre con il 99° percentile delle attese, il n° di operazioni
+ *	pubblicate e non ancora eseguite e la profondità massima raggiunta.
+ *	@param fd File descriptor su cui stampare
+ *	@param ch Canale del figlio
+ *	@param id N° del figlio
+ */
+void contatori_stampa(int fd, const canale* ch, int id);
+
+/**
+ *	@brief Funzione per la creazione di un vettore di semafori
+ *
+ *	Crea in modo esclusivo un vettore di n semafori associato alla chiave key
+ *	(IPC_PRIVATE per un vettore privato dell'istanza, da passare ai figli con
+ *	sem_identificatore()) e li inizializza al valore indicato.
+ *	@param key Chiave del vettore di semafori
+ *	@param n N° di semafori del vettore
+ *	@param valore Valore iniziale dei semafori
+ *	@return Id del vettore di semafori, -1 in caso di errore
+ */
+int sem_crea(key_t key, int n, int valore);
+
+/**
+ *	@brief Funzione che restituisce l'identificatore di sistema di un vettore di semafori
+ *
+ *	L'identificatore può essere passato a un altro processo, che vi si
+ *	collega con sem_apri().
+ *	@param semid Id del vettore di semafori
+ *	@return Identificatore di sistema del vettore
+ */
+int sem_identificatore(int semid);
+
+/**
+ *	@brief Funzione per il recupero di un vettore di semafori dal suo identificatore di sistema
+ *
+ *	@param identificatore Identificatore restituito da sem_identificatore()
+ *	@return Id del vettore di semafori, -1 in caso di errore
+ */
+int sem_apri(int identificatore);
+
+/**
+ *	@brief Funzione per il recupero di un vettore di semafori creato da un altro processo
+ *
+ *	@param key Chiave del vettore di semafori
+ *	@param n N° di semafori del vettore
+ *	@return Id del vettore di semafori, -1 in caso di errore
+ */
+int sem_collega(key_t key, int n);
+
+/**
+ *	@brief Procedura per la rimozione di un vettore di semafori
+ *
+ *	@param semid Id del vettore di semafori
+ */
+void sem_rimuovi(int semid);
+
+/**
+ *	@brief Funzione per la lettura del valore di un semaforo
+ *
+ *  @param semid Id del vettore di semafori
+ *	@param num N° del semaforo
+ *	@return Valore corrente del semaforo
+ */
+int sem_valore(int semid, int num);
+
 /**
  *	@brief Procedura per l'esecuzione di una signal su un semaforo
  *
@@ -70,6 +296,29 @@ void sem_signal(int semid, int num);
  */
 void sem_wait(int semid, int num);
 
+/**
+ *	@brief Funzione per l'esecuzione di una wait non bloccante su un semaforo
+ *
+ *	Decrementa il valore del semaforo indicato se positivo, altrimenti
+ *	ritorna immediatamente senza bloccarsi.
+ *  @param semid Id del vettore di semafori
+ *	@param num N° del semaforo su cui eseguire l'operazione
+ *	@return true se il semaforo è stato decrementato, false altrimenti
+ */
+bool sem_trywait(int semid, int num);
+
+/**
+ *	@brief Funzione per l'esecuzione di una wait con tempo massimo su un semaforo
+ *
+ *	Decrementa il valore del semaforo indicato se positivo, altrimenti
+ *	attende bloccandosi al più per il tempo indicato.
+ *  @param semid Id del vettore di semafori
+ *	@param num N° del semaforo su cui eseguire l'operazione
+ *	@param millisecondi Tempo massimo di attesa (ms)
+ *	@return true se il semaforo è stato decrementato, false se il tempo è scaduto
+ */
+bool sem_timedwait(int semid, int num, int millisecondi);
+
 /**
  *  @brief Funzione per la stampa di un messaggio a video.
  *
@@ -81,32 +330,56 @@ void sem_wait(int semid, int num);
 void my_write(int fd, char* msg);
 
 /**
-	@brief Funzione per la lettura di una linea del file fd.
- 
-	@param fd File descriptor del file su cui effettuare la lettura.
-	@return Stringa contenente l'ultima riga letta.
- */
-char* leggi_linea(int fd);
+	@brief Procedura per l'inizializzazione del livello di log
 
-/**
-	@brief Funzione che esegue la divisione in token di una stringa
-	passata come parametro.
- 
-	@param line Stringa letta dalla funzione leggi_linea dal file di configurazione
-	che deve essere tokenizzata.
-	@return Struttura dati contenente le variabili da passare alla routine del
-	processo figlio per l'esecuzione dei calcoli.
+	Legge il livello dalla variabile d'ambiente LOG_ENV, se presente e valida.
  */
-dati* tokenize(char* line);
+void log_inizializza(void);
 
 /**
 	@brief Funzione che libera lo spazio allocato alle risorse create
  
 	@param buffer Struttura dati condivisa
-	@param shmid Identificatore della memoria condivisa
+	@param shmid Identificatore della memoria condivisa (-1 se i canali sono in memoria privata)
 	@param semid_e Identificatore del vettore di semafori empty
 	@param semid_f Identificatore del vettore di semafori full
  */
-void free_resources(dati* buffer, int shmid, int semid_e, int semid_f);
+void free_resources(void* buffer, int shmid, int semid_e, int semid_f);
+
+/**
+	@brief Funzione che verifica se il processo pid è ancora in esecuzione
+
+	Un processo terminato ma non ancora atteso dal padre (zombie) non è in
+	esecuzione, anche se kill() lo trova ancora.
+	@param pid Pid del processo
+	@return true se il processo è in esecuzione
+ */
+bool processo_attivo(pid_t pid);
+
+/**
+	@brief Funzione che annota un oggetto IPC nel file dell'istanza corrente
+
+	@param tipo Tipo di oggetto (ISTANZA_SEMAFORI o ISTANZA_MEMORIA)
+	@param id Identificatore di sistema dell'oggetto
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int istanza_registra(char tipo, int id);
+
+/**
+	@brief Procedura di rimozione degli oggetti IPC delle istanze terminate
+
+	Rimuove gli oggetti annotati nei file delle istanze il cui processo non
+	è più in esecuzione (terminate senza liberare le risorse, anche se non
+	ancora attese dal loro padre) e i relativi file. I processi ancora
+	bloccati sui semafori rimossi vengono svegliati e terminano con un errore.
+ */
+void istanza_pulisci(void);
+
+/**
+	@brief Procedura di rimozione del file dell'istanza corrente
+
+	Da chiamare dopo aver liberato le risorse annotate.
+ */
+void istanza_termina(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,169 @@
+/** @file genera.c
+
+	@brief Programma di generazione di file di configurazione sintetici.
+
+	Uso: genera [-n operazioni] [-w figli] [-m operatori] [-z percentuale_id0] [-k asimmetria] [-r seme] [-o file]<br>
+	- -n: n° di operazioni da generare (default 1000000).<br>
+	- -w: n° di processi da simulare (default 4).<br>
+	- -m: miscela degli operatori tra +, -, * e /: ogni carattere della stringa
+	ha la stessa probabilità, per cui un operatore ripetuto è più frequente
+	(es. "++-*", default tutti e quattro).<br>
+	- -z: percentuale di operazioni con id 0, assegnate al figlio meno carico
+	(default 50).<br>
+	- -k: percentuale delle operazioni con id diverso da 0 assegnate al
+	figlio 1, le altre sono distribuite uniformemente (default 0).<br>
+	- -r: seme del generatore pseudocasuale, a parità di seme e di opzioni il
+	file generato è identico (default 1).<br>
+	- -o: file da scrivere (default lo standard output).<br>
+
+	Il file generato è nel formato testo letto da elab2.
+ */
+#include "functions.h"
+#include "binario.h"
+
+#include <stdint.h>
+
+#define DIMENSIONE_USCITA (1 << 20)	/**< Dimensione del buffer di scrittura */
+
+char uscita[DIMENSIONE_USCITA];		/**< Buffer di scrittura */
+int n_uscita = 0;					/**< N° di byte presenti nel buffer di scrittura */
+int fd_uscita = 1;					/**< File descriptor del file da scrivere */
+uint64_t stato;						/**< Stato del generatore pseudocasuale */
+
+/**
+	@brief Funzione che restituisce il prossimo numero pseudocasuale (xorshift64*)
+ */
+static uint64_t casuale(void){
+    stato ^= stato >> 12;
+    stato ^= stato << 25;
+    stato ^= stato >> 27;
+    
+    return stato * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+	@brief Funzione che restituisce un intero pseudocasuale in [minimo, massimo]
+ */
+static int intervallo(int minimo, int massimo){
+    return minimo + (int) (casuale() % (uint64_t) (massimo - minimo + 1));
+}
+
+/**
+	@brief Procedura che accoda una linea al buffer di scrittura, svuotandolo se pieno
+ */
+static void accoda(const char* linea, int n){
+    if(n_uscita + n > DIMENSIONE_USCITA){
+        if(scrivi_tutto(fd_uscita, uscita, n_uscita) == -1){
+            my_write(2, "ERRORE: Scrittura file generato\n");
+            exit(1);
+        }
+        n_uscita = 0;
+    }
+    
+    memcpy(uscita + n_uscita, linea, n);
+    n_uscita += n;
+}
+
+int main(int argc, char *argv[]){
+    int opzione;					/* Opzione letta dalla riga di comando */
+    long operazioni = 1000000;		/* N° di operazioni da generare */
+    int figli = 4;					/* N° di processi da simulare */
+    char* operatori = "+-*/";		/* Miscela degli operatori */
+    int id0 = 50;					/* Percentuale di operazioni con id 0 */
+    int asimmetria = 0;				/* Percentuale di operazioni con id != 0 per il figlio 1 */
+    char linea[64];					/* Linea da scrivere */
+    long i;
+    int id, num1, num2, n;
+    char op;
+    
+    stato = 1;
+    
+    while((opzione = getopt(argc, argv, "n:w:m:z:k:r:o:")) != -1){
+        switch(opzione){
+            case 'n':
+                operazioni = atol(optarg);
+                break;
+            case 'w':
+                figli = atoi(optarg);
+                break;
+            case 'm':
+                operatori = optarg;
+                break;
+            case 'z':
+                id0 = atoi(optarg);
+                break;
+            case 'k':
+                asimmetria = atoi(optarg);
+                break;
+            case 'r':
+                stato = strtoull(optarg, NULL, 10);
+                break;
+            case 'o':
+                if((fd_uscita = creat(optarg, 0644)) == -1){
+                    sprintf(sprintf_buffer, "ERRORE: Creazione file %s\n", optarg);
+                    my_write(2, sprintf_buffer);
+                    exit(1);
+                }
+                break;
+            default:
+                goto uso;
+        }
+    }
+    
+    /**
+     Controllo i parametri: gli operatori devono essere tra quelli eseguiti
+     dai figli e le percentuali comprese tra 0 e 100.
+     */
+    if(operazioni < 0 || figli < 1 || operatori[0] == '\0' || strspn(operatori, "+-*/") != strlen(operatori) ||
+       id0 < 0 || id0 > 100 || asimmetria < 0 || asimmetria > 100)
+        goto uso;
+    
+    /**
+     Il seme 0 bloccherebbe xorshift su 0: lo sostituisco.
+     */
+    if(stato == 0)
+        stato = 1;
+    
+    n = sprintf(linea, "%d\n", figli);
+    accoda(linea, n);
+    
+    for(i=0; i<operazioni; i++){
+        /**
+         Scelgo l'id: 0 con probabilità id0, altrimenti il figlio 1 con
+         probabilità asimmetria o un figlio qualsiasi.
+         */
+        if(intervallo(1, 100) <= id0)
+            id = 0;
+        else if(intervallo(1, 100) <= asimmetria)
+            id = 1;
+        else
+            id = intervallo(1, figli);
+    
+        op = operatori[casuale() % strlen(operatori)];
+        num1 = intervallo(-100000, 100000);
+    
+        /**
+         Il secondo operando non è mai 0, così che le divisioni siano valide.
+         */
+        num2 = intervallo(1, 1000);
+        if(casuale() & 1)
+            num2 = -num2;
+    
+        n = sprintf(linea, "%d %d %c %d\n", id, num1, op, num2);
+        accoda(linea, n);
+    }
+    
+    if(scrivi_tutto(fd_uscita, uscita, n_uscita) == -1){
+        my_write(2, "ERRORE: Scrittura file generato\n");
+        exit(1);
+    }
+    
+    if(fd_uscita != 1)
+        close(fd_uscita);
+    
+    exit(0);
+    
+uso:
+    my_write(2, "Uso: genera [-n operazioni] [-w figli] [-m operatori (+-*/)] [-z percentuale_id0] [-k asimmetria] [-r seme] [-o file]\n");
+    exit(1);
+}
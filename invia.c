@@ -0,0 +1,133 @@
+/** @file invia.c
+
+	@brief Programma cliente del demone di elab2.
+
+	Uso: invia [-i input] [-o output] [-B] | invia -q<br>
+	- -i: file di configurazione (testo o binario) da eseguire (default config.txt).<br>
+	- -o: file su cui scrivere i risultati (default res.txt, "-" per lo standard output).<br>
+	- -B: scrive i risultati nel formato binario descritto in binario.h.<br>
+	- -q: richiede la terminazione del demone e ne attende la fine.<br>
+
+	Carica il file con carica_file(), invia le operazioni al demone (elab2 -D)
+	attraverso lo sportello (vedi sportello.h) e scrive i risultati nello
+	stesso formato di elab2. La prima riga del file (n° di processi) è
+	ignorata: le operazioni sono eseguite dai figli del demone.
+ */
+#include "functions.h"
+#include "parser.h"
+#include "binario.h"
+#include "scrittore.h"
+#include "sportello.h"
+
+int main(int argc, char *argv[]){
+    int opzione;					/* Opzione letta dalla riga di comando */
+    char* file_input = "config.txt";	/* File di configurazione da eseguire */
+    char* file_output = "res.txt";	/* File su cui scrivere i risultati */
+    bool output_binario = false;	/* Flag: risultati in formato binario */
+    bool arresta = false;			/* Flag: richiesta di terminazione del demone */
+    accesso sportello_demone;		/* Sportello del demone */
+    lavoro job;						/* Contenuto del file di configurazione */
+    res* risultati;					/* Risultati nell'ordine delle operazioni */
+    scrittore output;				/* Scrittore bufferizzato sul file di output */
+    int fd, i;
+    
+    while((opzione = getopt(argc, argv, "i:o:Bq")) != -1){
+        switch(opzione){
+            case 'i':
+                file_input = optarg;
+                break;
+            case 'o':
+                file_output = optarg;
+                break;
+            case 'B':
+                output_binario = true;
+                break;
+            case 'q':
+                arresta = true;
+                break;
+            default:
+                my_write(2, "Uso: invia [-i input] [-o output] [-B] | invia -q\n");
+                exit(1);
+        }
+    }
+    
+    if(sportello_collega(&sportello_demone) == -1){
+        my_write(1, "ERRORE: Nessun demone in esecuzione (elab2 -D figli)\n");
+        exit(1);
+    }
+    
+    if(arresta){
+        sportello_arresta(&sportello_demone);
+        sportello_scollega(&sportello_demone);
+        exit(0);
+    }
+    
+    if(carica_file(file_input, &job) == -1)
+        exit(1);
+    
+    if(job.riferimenti != NULL){
+        snprintf(sprintf_buffer, sizeof(sprintf_buffer), "ERRORE: %s: il demone non esegue operazioni con operandi $k\n", file_input);
+        my_write(1, sprintf_buffer);
+        exit(1);
+    }
+    
+    if((risultati = (res *) malloc(sizeof(res) * (job.n_operazioni + 1))) == NULL){
+        my_write(1, "ERRORE: Allocazione del vettore dei risultati\n");
+        exit(1);
+    }
+    
+    /**
+     Il demone esegue il lavoro e restituisce i risultati nell'ordine delle operazioni.
+     */
+    if(sportello_esegui(&sportello_demone, job.operazioni, job.n_operazioni, risultati) == -1){
+        sprintf(sprintf_buffer, "ERRORE: Il demone ha rifiutato il lavoro %s\n", file_input);
+        my_write(1, sprintf_buffer);
+        exit(1);
+    }
+    
+    sportello_scollega(&sportello_demone);
+    
+    /**
+     Scrivo i risultati preceduti dall'intestazione, come elab2.
+     */
+    if(strcmp(file_output, "-") == 0)
+        fd = 1;
+    else if((fd = creat(file_output, 0777)) == -1){
+        sprintf(sprintf_buffer, "ERRORE: Creazione file %s\n", file_output);
+        my_write(1, sprintf_buffer);
+        exit(1);
+    }
+    
+    if(scrittore_apri(&output, fd, false) == -1){
+        my_write(1, "ERRORE: Creazione buffer di scrittura dei risultati\n");
+        exit(1);
+    }
+    
+    if(output_binario)
+        binario_scrivi_intestazione(fd, MAGIC_RISULTATI, job.n_operazioni);
+    else
+        scrittore_accoda(&output, "*************************\n"
+                                  "*      RISULTATI        *\n"
+                                  "*************************\n", 78);
+    
+    for(i=0; i<job.n_operazioni; i++){
+        if(output_binario)
+            scrittore_record(&output, &risultati[i]);
+        else
+            scrittore_risultato(&output, i+1, &risultati[i]);
+    }
+    
+    if(scrittore_chiudi(&output) == -1){
+        sprintf(sprintf_buffer, "ERRORE: Scrittura file %s\n", file_output);
+        my_write(1, sprintf_buffer);
+        exit(1);
+    }
+    
+    if(fd != 1)
+        close(fd);
+    
+    free(risultati);
+    free(job.operazioni);
+    
+    exit(0);
+}
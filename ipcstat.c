@@ -0,0 +1,130 @@
+/** @file ipcstat.c
+
+	@brief Programma di lettura dei contatori delle prestazioni di una simulazione in corso.
+
+	Uso: ipcstat -m segmento [-i secondi] [-n volte]<br>
+	- -m: id del segmento dei canali della simulazione, stampato da elab2
+	all'avvio (ogni istanza di elab2 ha il proprio segmento).<br>
+	- -i: ristampa i contatori ogni secondi secondi, aggiungendo per ogni
+	figlio le operazioni al secondo e la percentuale di tempo di lavoro
+	nell'intervallo (default: una sola stampa).<br>
+	- -n: n° di stampe da eseguire con -i (default: finchè la simulazione è in corso).<br>
+
+	Si collega in sola lettura al segmento di memoria condivisa di elab2,
+	ricava il n° di figli dalla sua dimensione e stampa i
+	contatori di ciascun canale (vedi contatori_figlio e contatori_padre).
+	Non interferisce con la simulazione: i contatori sono letti senza
+	sincronizzazione, per cui i valori sono indicativi.<br>
+	Con i figli eseguiti come thread (elab2 -T) i canali non sono in memoria
+	condivisa e i contatori sono stampati solo da elab2 al termine.
+ */
+#include "functions.h"
+
+#include <time.h>
+
+int main(int argc, char *argv[]){
+    int opzione;					/* Opzione letta dalla riga di comando */
+    int intervallo = 0;				/* Secondi tra due stampe, 0 per una sola stampa */
+    int volte = -1;					/* N° di stampe rimaste, -1 per nessun limite */
+    struct shmid_ds info;			/* Informazioni sul segmento condiviso */
+    canale* canali;					/* Canali dei figli */
+    int n;							/* N° di figli */
+    int i;
+    long long* operazioni;			/* Operazioni eseguite da ciascun figlio alla stampa precedente */
+    long long* lavoro_ns;			/* Tempo di lavoro di ciascun figlio alla stampa precedente */
+    long long adesso, precedente = 0;
+    struct timespec t;
+
+    shmid = -1;
+
+    while((opzione = getopt(argc, argv, "m:i:n:")) != -1){
+        switch(opzione){
+            case 'm':
+                if((shmid = atoi(optarg)) >= 0)
+                    break;
+                goto uso;
+            case 'i':
+                if((intervallo = atoi(optarg)) > 0)
+                    break;
+                goto uso;
+            case 'n':
+                if((volte = atoi(optarg)) > 0)
+                    break;
+                goto uso;
+            default:
+            uso:
+                my_write(2, "Uso: ipcstat -m segmento [-i secondi] [-n volte]\n");
+                exit(1);
+        }
+    }
+
+    if(shmid == -1){
+        my_write(2, "Uso: ipcstat -m segmento [-i secondi] [-n volte]\n");
+        exit(1);
+    }
+
+    /**
+     Recupero il segmento dei canali e ne ricavo il n° di figli.
+     */
+    if(shmctl(shmid, IPC_STAT, &info) == -1){
+        sprintf(sprintf_buffer, "ERRORE: Nessuna simulazione in corso con il segmento %d\n", shmid);
+        my_write(2, sprintf_buffer);
+        exit(1);
+    }
+
+    n = info.shm_segsz / sizeof(canale);
+
+    if(n == 0 || (canali = (canale *) shmat(shmid, 0, SHM_RDONLY)) == (canale *) -1){
+        my_write(2, "ERRORE: Mappatura della memoria condivisa in sola lettura\n");
+        exit(1);
+    }
+
+    operazioni = (long long *) calloc(n, sizeof(long long));
+    lavoro_ns = (long long *) calloc(n, sizeof(long long));
+
+    while(1){
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        adesso = (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+
+        sprintf(sprintf_buffer, "*** %d figli ***\n", n);
+        my_write(1, sprintf_buffer);
+
+        for(i=0; i<n; i++){
+            contatori_stampa(1, canali+i, i);
+
+            /**
+             Dalla seconda stampa aggiungo operazioni al secondo e percentuale
+             di lavoro nell'intervallo.
+             */
+            if(precedente != 0){
+                sprintf(sprintf_buffer, "          nell'intervallo: %.0f operazioni/s, lavoro %.1f%%\n",
+                        (canali[i].figlio.operazioni - operazioni[i]) * 1e9 / (adesso - precedente),
+                        (canali[i].figlio.lavoro_ns - lavoro_ns[i]) * 100.0 / (adesso - precedente));
+                my_write(1, sprintf_buffer);
+            }
+
+            operazioni[i] = canali[i].figlio.operazioni;
+            lavoro_ns[i] = canali[i].figlio.lavoro_ns;
+        }
+
+        precedente = adesso;
+
+        if(intervallo == 0 || (volte != -1 && --volte == 0))
+            break;
+
+        sleep(intervallo);
+
+        /**
+         Termino se sono l'unico processo ancora collegato al segmento
+         (simulazione terminata): elab2 lo marca per la rimozione alla creazione.
+         */
+        if(shmctl(shmid, IPC_STAT, &info) == -1 || info.shm_nattch <= 1)
+            break;
+    }
+
+    shmdt(canali);
+    free(operazioni);
+    free(lavoro_ns);
+
+    exit(0);
+}
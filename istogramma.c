@@ -0,0 +1,45 @@
+/** @file istogramma.c
+
+	@brief Libreria per gli istogrammi delle latenze.
+ */
+#include "istogramma.h"
+
+/**
+	@brief Funzione che restituisce il limite superiore di un intervallo dell'istogramma
+ */
+static long long limite(int i){
+    int esponente = i / ISTOGRAMMA_SOTTO - 1 + ISTOGRAMMA_BIT;
+    
+    if(i < ISTOGRAMMA_SOTTO)
+        return i;
+    
+    return ((long long) (ISTOGRAMMA_SOTTO + i % ISTOGRAMMA_SOTTO + 1) << (esponente - ISTOGRAMMA_BIT)) - 1;
+}
+
+/**
+	@brief Funzione che calcola un percentile dei valori dell'istogramma
+
+	@param h Istogramma
+	@param percentile Percentuale (0-100)
+	@return Limite superiore dell'intervallo contenente il percentile, 0 se l'istogramma è vuoto
+ */
+long long istogramma_percentile(const istogramma* h, double percentile){
+    long long soglia, somma = 0;
+    int i;
+    
+    if(h->n == 0)
+        return 0;
+    
+    soglia = (long long) (percentile / 100.0 * h->n + 0.5);
+    if(soglia < 1)
+        soglia = 1;
+    
+    for(i=0; i<ISTOGRAMMA_INTERVALLI; i++){
+        somma += h->intervalli[i];
+        
+        if(somma >= soglia)
+            return limite(i) < h->massimo ? limite(i) : h->massimo;
+    }
+    
+    return h->massimo;
+}
@@ -0,0 +1,73 @@
+/** @file istogramma.h
+
+	@brief Libreria per gli istogrammi delle latenze.
+
+	Istogramma a memoria costante in stile HDR: i valori minori di
+	ISTOGRAMMA_SOTTO hanno un intervallo ciascuno, gli altri sono divisi in
+	ISTOGRAMMA_SOTTO intervalli per ogni potenza di 2, per cui i percentili
+	sono ricavati con un errore relativo inferiore a 1/ISTOGRAMMA_SOTTO.<br>
+	L'aggiunta di un valore costa pochi cicli e nessuna allocazione; ogni
+	istogramma deve avere un solo scrittore, mentre può essere letto da altri
+	processi (ad esempio da ipcstat) mentre viene aggiornato.
+ */
+
+#ifndef ISTOGRAMMA_H
+#define ISTOGRAMMA_H
+
+#define ISTOGRAMMA_SOTTO 16	/**< N° di intervalli dell'istogramma per ogni potenza di 2 (potenza di 2) */
+#define ISTOGRAMMA_BIT 4	/**< log2(ISTOGRAMMA_SOTTO) */
+#define ISTOGRAMMA_INTERVALLI (64 * ISTOGRAMMA_SOTTO)	/**< N° di intervalli dell'istogramma */
+
+/**
+	Istogramma di valori non negativi (latenze in nanosecondi).
+ */
+typedef struct istogramma {
+    long long n;				/**< N° di valori aggiunti */
+    long long massimo;			/**< Valore massimo aggiunto */
+    long long intervalli[ISTOGRAMMA_INTERVALLI];	/**< N° di valori in ciascun intervallo */
+} istogramma;
+
+/**
+	@brief Funzione che restituisce l'intervallo dell'istogramma di un valore
+
+	@param v Valore non negativo
+	@return Indice dell'intervallo
+ */
+static inline int istogramma_intervallo(long long v){
+    int esponente;
+    
+    if(v < ISTOGRAMMA_SOTTO)
+        return (int) v;
+    
+    esponente = 63 - __builtin_clzll((unsigned long long) v);
+    
+    return (esponente - ISTOGRAMMA_BIT + 1) * ISTOGRAMMA_SOTTO + (int) ((v >> (esponente - ISTOGRAMMA_BIT)) & (ISTOGRAMMA_SOTTO - 1));
+}
+
+/**
+	@brief Procedura che aggiunge un valore all'istogramma
+
+	@param h Istogramma
+	@param v Valore (i valori negativi sono contati come 0)
+ */
+static inline void istogramma_aggiungi(istogramma* h, long long v){
+    if(v < 0)
+        v = 0;
+    
+    h->intervalli[istogramma_intervallo(v)]++;
+    h->n++;
+    
+    if(v > h->massimo)
+        h->massimo = v;
+}
+
+/**
+	@brief Funzione che calcola un percentile dei valori dell'istogramma
+
+	@param h Istogramma
+	@param percentile Percentuale (0-100)
+	@return Limite superiore dell'intervallo contenente il percentile, 0 se l'istogramma è vuoto
+ */
+long long istogramma_percentile(const istogramma* h, double percentile);
+
+#endif
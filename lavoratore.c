@@ -0,0 +1,256 @@
+/** @file lavoratore.c
+
+	@brief Libreria contenente la routine di calcolo dei figli.
+ */
+#include "lavoratore.h"
+#include "calcolo.h"
+#include "statistiche.h"
+#include "attesa.h"
+
+/**
+	@brief Procedura per l'esecuzione delle operazioni [inizio, fine) di un vettore circolare di slot
+
+	Esegue i calcoli con il kernel vettoriale, separatamente per i due tratti
+	contigui del vettore circolare, salva ciascun risultato nell'area di
+	appoggio alla posizione data dal suo n° di sequenza, lo inserisce nella
+	cache dei risultati se attiva e aggiorna il contatore delle operazioni
+	completate.<br>
+	Il tempo dei calcoli è aggiunto ai contatori del figlio; se l'area
+	contiene il vettore dei tempi vi salva la latenza di ciascuna operazione,
+	usando la stessa lettura dell'orologio per tutto il tratto.
+	@param slot Vettore circolare di CAPACITA_CANALE slot
+	@param inizio Indice della prima operazione
+	@param fine Indice successivo all'ultima operazione
+	@param appoggio Area di appoggio dei risultati
+	@param contatori Contatori del figlio che esegue le operazioni
+ */
+static void esegui_slot(dati* slot, unsigned int inizio, unsigned int fine, area_appoggio* appoggio, contatori_figlio* contatori){
+    unsigned int i, j;
+    long long inizio_calcoli = statistiche_adesso();	/* Istante di inizio dei calcoli */
+    long long adesso;
+    
+    if(fine % CAPACITA_CANALE < inizio % CAPACITA_CANALE || fine - inizio == CAPACITA_CANALE){
+        calcola_operazioni(&slot[inizio % CAPACITA_CANALE], CAPACITA_CANALE - inizio % CAPACITA_CANALE);
+        calcola_operazioni(&slot[0], fine % CAPACITA_CANALE);
+    } else {
+        calcola_operazioni(&slot[inizio % CAPACITA_CANALE], fine - inizio);
+    }
+    
+    adesso = statistiche_adesso();
+    contatori->lavoro_ns += adesso - inizio_calcoli;
+    contatori->operazioni += fine - inizio;
+    contatori->lotti++;
+    
+    if(appoggio->tempi != NULL){
+        for(i=inizio; i != fine; i++){
+            j = slot[i % CAPACITA_CANALE].indice % appoggio->n_risultati;
+            appoggio->tempi[j] = adesso - appoggio->tempi[j];
+        }
+    }
+    
+    for(i=inizio; i != fine; i++)
+        appoggio_salva(appoggio, &slot[i % CAPACITA_CANALE]);
+    
+    if(appoggio->cache.voci != NULL){
+        for(i=inizio; i != fine; i++)
+            cache_inserisci(&appoggio->cache, &slot[i % CAPACITA_CANALE]);
+    }
+    
+    __atomic_fetch_add(appoggio->completati, fine - inizio, __ATOMIC_RELEASE);
+}
+
+/**
+	@brief Funzione per l'esecuzione delle operazioni della coda di lavoro di un figlio
+
+	Riserva con una compare-and-swap su testa tutte le operazioni presenti
+	nella coda di lavoro del figlio vittima (metà, arrotondata per eccesso,
+	se si tratta di un furto), le esegue, alza res_disponibile in ciascuno
+	slot e sveglia il padre se attende spazio nel canale della vittima.
+	@param buffer_comune Canali dei figli
+	@param appoggio Area di appoggio dei risultati
+	@param vittima N° del figlio proprietario della coda di lavoro
+	@param id N° del figlio che esegue le operazioni
+	@return true se è stata eseguita almeno un'operazione
+ */
+static bool esegui_lavoro(canale* buffer_comune, area_appoggio* appoggio, int vittima, int id){
+    coda_lavoro* q = &(buffer_comune+vittima)->lavoro;
+    unsigned int testa = __atomic_load_n(&q->testa, __ATOMIC_ACQUIRE);
+    unsigned int n, i;
+    dati* d;
+    
+    do {
+        n = __atomic_load_n(&q->coda, __ATOMIC_ACQUIRE) - testa;
+        if(n == 0)
+            return false;
+        
+        if(vittima != id)
+            n = (n + 1) / 2;
+    } while(!__atomic_compare_exchange_n(&q->testa, &testa, testa + n, false, __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE));
+    
+    esegui_slot(q->slot, testa, testa + n, appoggio, &(buffer_comune+id)->figlio);
+    
+    if(vittima != id)
+        (buffer_comune+id)->figlio.rubate += n;
+    
+    for(i=testa; i != testa + n; i++){
+        d = &q->slot[i % CAPACITA_CANALE];
+        
+        if(vittima != id)
+            LOG(LOG_OPERAZIONI, "						#%d: Ho rubato a #%d %d %c %d\n", id+1, vittima+1, d->num1, d->op, d->num2);
+        else
+            LOG(LOG_OPERAZIONI, "						#%d: Ho letto %d %c %d\n", id+1, d->num1, d->op, d->num2);
+        
+        __atomic_store_n(&d->res_disponibile, true, __ATOMIC_RELEASE);
+    }
+    
+    if(__atomic_exchange_n(&(buffer_comune+vittima)->padre_attende, 0, __ATOMIC_SEQ_CST) == 1)
+        sem_signal(semid_empty, vittima);
+    
+    return true;
+}
+
+/**
+	@brief Funzione per il furto di operazioni dalla coda di lavoro più lunga
+
+	@param buffer_comune Canali dei figli
+	@param numero_processi N° di figli
+	@param appoggio Area di appoggio dei risultati
+	@param id N° del figlio che ruba
+	@return true se è stata rubata ed eseguita almeno un'operazione
+ */
+static bool ruba_lavoro(canale* buffer_comune, int numero_processi, area_appoggio* appoggio, int id){
+    coda_lavoro* q;
+    unsigned int n, massimo = 0;
+    int j, vittima = -1;
+    
+    /**
+     Scorro gli altri figli a partire dal successivo, così che figli diversi
+     non scelgano tutti la stessa vittima a parità di lunghezza.
+     */
+    for(j=1; j<numero_processi; j++){
+        q = &(buffer_comune + (id + j) % numero_processi)->lavoro;
+        n = __atomic_load_n(&q->testa, __ATOMIC_ACQUIRE);
+        n = __atomic_load_n(&q->coda, __ATOMIC_ACQUIRE) - n;
+        
+        if(n > massimo){
+            massimo = n;
+            vittima = (id + j) % numero_processi;
+        }
+    }
+    
+    return vittima != -1 && esegui_lavoro(buffer_comune, appoggio, vittima, id);
+}
+
+/**
+	@brief Funzione che verifica se il canale o la coda di lavoro di un figlio contengono operazioni
+ */
+static bool lavoro_presente(const void* arg){
+    const canale* ch = (const canale *) arg;
+    
+    return __atomic_load_n(&ch->coda, __ATOMIC_SEQ_CST) != __atomic_load_n(&ch->testa, __ATOMIC_RELAXED) ||
+           __atomic_load_n(&ch->lavoro.coda, __ATOMIC_SEQ_CST) != __atomic_load_n(&ch->lavoro.testa, __ATOMIC_SEQ_CST);
+}
+
+/**
+	@brief Procedura che esegue la routine di calcolo del figlio id
+
+	Lo stato della routine è interamente locale, così che più figli possano
+	eseguirla in parallelo come thread dello stesso processo.
+	@param buffer_comune Canali dei figli
+	@param numero_processi N° di figli
+	@param appoggio Area di appoggio dei risultati
+	@param id N° del figlio
+ */
+void lavoratore_esegui(canale* buffer_comune, int numero_processi, area_appoggio* appoggio, int id){
+    canale* ch = buffer_comune+id;	/* Canale del figlio */
+    dati* d;						/* Slot del canale contenente l'operazione corrente */
+    unsigned int testa;				/* Indice della prossima operazione da eseguire */
+    unsigned int coda;				/* Indice di fine delle operazioni accodate dal padre */
+    unsigned int fine;				/* Indice di fine del lotto da eseguire (escluso l'eventuale 'K') */
+    long long attesa;				/* Durata dell'attesa sul semaforo full */
+    struct attesa stato_attesa = {0};	/* Stato delle attese del figlio */
+    
+    testa = ch->testa;
+    
+    /**
+     Entro in un ciclo infinito per l'esecuzione della routine.
+     */
+    while(1){
+        coda = __atomic_load_n(&ch->coda, __ATOMIC_ACQUIRE);
+        
+        /**
+         Se il canale è vuoto eseguo le operazioni della mia coda di lavoro o,
+         se è vuota, ne rubo dagli altri figli. Se non c'è lavoro attendo
+         attivamente secondo la politica di attesa (vedi attesa.h); se non
+         arriva segnalo al padre che sto per bloccarmi, ricontrollo canale e
+         coda di lavoro e attendo su un semaforo che il padre mi comunichi la
+         presenza di operandi.
+         */
+        if(testa == coda){
+            if(esegui_lavoro(buffer_comune, appoggio, id, id) || ruba_lavoro(buffer_comune, numero_processi, appoggio, id))
+                continue;
+            
+            if(attesa_attiva(&stato_attesa, lavoro_presente, ch))
+                continue;
+            
+            __atomic_store_n(&ch->figlio_attende, 1, __ATOMIC_SEQ_CST);
+            if(__atomic_load_n(&ch->coda, __ATOMIC_SEQ_CST) == testa &&
+               __atomic_load_n(&ch->lavoro.coda, __ATOMIC_SEQ_CST) == __atomic_load_n(&ch->lavoro.testa, __ATOMIC_SEQ_CST)){
+                attesa = statistiche_adesso();
+                sem_wait(semid_full, id);
+                attesa = statistiche_adesso() - attesa;
+                
+                ch->figlio.attesa_ns += attesa;
+                istogramma_aggiungi(&ch->figlio.attese, attesa);
+            }
+            __atomic_store_n(&ch->figlio_attende, 0, __ATOMIC_SEQ_CST);
+            attesa_termina(&stato_attesa);
+            continue;
+        }
+        
+        /**
+         Scorro le operazioni accodate dal padre fino all'eventuale segnale di
+         terminazione 'K' e stampo un messaggio di notifica della ricezione dei valori.
+         */
+        for(fine=testa; fine != coda; fine++){
+            d = &ch->slot[fine % CAPACITA_CANALE];
+            
+            if(d->op == 'K')
+                break;
+            
+            LOG(LOG_OPERAZIONI, "						#%d: Ho letto %d %c %d\n", id+1, d->num1, d->op, d->num2);
+        }
+        
+        /**
+         Eseguo i calcoli dell'intero lotto con il kernel vettoriale e salvo i
+         risultati nell'area di appoggio.
+         */
+        esegui_slot(ch->slot, testa, fine, appoggio, &ch->figlio);
+        testa = fine;
+        
+        /**
+         Se il padre ha inviato il segnale di terminazione libero gli slot
+         delle operazioni precedenti e di 'K', eseguo le operazioni rimaste nella mia
+         coda di lavoro (il padre non ne accoda altre), stampo un messaggio di
+         notifica terminazione e termino l'esecuzione della routine.
+         */
+        if(fine != coda) {
+            __atomic_store_n(&ch->testa, testa + 1, __ATOMIC_SEQ_CST);
+            
+            while(esegui_lavoro(buffer_comune, appoggio, id, id))
+                ;
+            
+            LOG(LOG_FASI, "						#%d: Ho letto 'K' -> Termino esecuzione\n", id+1);
+            return;
+        }
+        
+        /**
+         Libero gli slot delle operazioni eseguite e sveglio il padre se attende
+         che si liberi spazio nel canale o che un risultato sia pronto.
+         */
+        __atomic_store_n(&ch->testa, testa, __ATOMIC_SEQ_CST);
+        
+        if(__atomic_exchange_n(&ch->padre_attende, 0, __ATOMIC_SEQ_CST) == 1)
+            sem_signal(semid_empty, id);
+    }
+}
@@ -0,0 +1,40 @@
+/** @file lavoratore.h
+
+	@brief Libreria contenente la routine di calcolo dei figli.
+
+	La routine è la stessa sia quando il figlio è un processo separato
+	(routine.c, avviato da elab2 con execvp) sia quando è un thread del
+	processo elab2 (opzione -T).
+ */
+
+#ifndef LAVORATORE_H
+#define LAVORATORE_H
+
+#include "functions.h"
+#include "appoggio.h"
+
+/**
+	@brief Procedura che esegue la routine di calcolo del figlio id
+
+	Esegue le operazioni accodate dal padre nel canale del figlio finchè non
+	riceve il segnale di terminazione 'K':<br>
+	- Esecuzione a lotto, con il kernel vettoriale di calcolo.c, di tutte
+	  le operazioni accodate dal padre nel canale.<br>
+	- Se il canale è vuoto: esecuzione delle operazioni con id 0 della propria
+	  coda di lavoro o, se anche questa è vuota, furto di metà delle operazioni
+	  dalla coda di lavoro più lunga tra quelle degli altri figli.<br>
+	- Se non c'è lavoro: attesa su un semaforo che il padre accodi operazioni.<br>
+	- Salvataggio dei risultati nell'area di appoggio, alla posizione data dal
+	  n° di sequenza di ciascuna operazione (e nella cache dei risultati, se
+	  attiva), e pubblicazione degli slot liberati
+	  al padre, svegliandolo se attende spazio nel canale o un risultato.<br>
+	Ricevuto 'K' esegue le operazioni rimaste nella propria coda di lavoro e termina.<br>
+	I semafori semid_empty e semid_full devono essere già collegati.
+	@param buffer_comune Canali dei figli
+	@param numero_processi N° di figli
+	@param appoggio Area di appoggio dei risultati
+	@param id N° del figlio
+ */
+void lavoratore_esegui(canale* buffer_comune, int numero_processi, area_appoggio* appoggio, int id);
+
+#endif
@@ -0,0 +1,728 @@
+/** @file parser.c
+
+	@brief Libreria per il caricamento del file di configurazione.
+ */
+#define _GNU_SOURCE
+#include "parser.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <limits.h>
+
+/**
+	Parte del testo di un file di configurazione, analizzata da un thread.
+ */
+typedef struct parte {
+    const char* inizio;			/* Inizio della parte (inizio di una linea) */
+    const char* fine;			/* Fine della parte (dopo un '\n' o fine del testo) */
+    int numero_processi;		/* N° di processi, per la verifica degli id */
+    int n_operazioni;			/* N° di linee non vuote, cioè di operazioni se nessuna è malformata */
+    bool dollari;				/* Flag: la parte contiene un carattere '$' */
+    dati* operazioni;			/* Posizione della parte nel vettore delle operazioni */
+    riferimento* riferimenti;	/* Posizione della parte nel vettore dei riferimenti, NULL se il file non ne contiene */
+    int righe;					/* N° di linee analizzate, compresa l'eventuale linea malformata */
+    bool errore;				/* Flag: l'analisi si è fermata a una linea malformata */
+} parte;
+
+/**
+	@brief Funzione che salta spazi e tabulazioni
+ */
+static inline const char* salta_spazi(const char* p, const char* fine){
+    while(p < fine && (*p == ' ' || *p == '\t'))
+        p++;
+    
+    return p;
+}
+
+/**
+	@brief Funzione che avanza *p all'inizio della linea successiva a q
+
+	@return L'esito passato come parametro
+ */
+static inline int salta_linea(const char** p, const char* q, const char* fine, int esito){
+    const char* eol = memchr(q, '\n', fine - q);
+    
+    *p = eol ? eol + 1 : fine;
+    
+    return esito;
+}
+
+/**
+	@brief Funzione per la lettura di un intero con segno
+
+	Il valore è accumulato su 64 bit e confrontato con il limite a ogni
+	cifra, così che un valore fuori da [INT_MIN, INT_MAX] venga rifiutato
+	invece di essere troncato.
+	@param p Puntatore alla posizione corrente, avanzato dopo l'ultima cifra
+	@param fine Fine del testo
+	@param valore Intero letto
+	@return true se è stata letta almeno una cifra e il valore è rappresentabile in un int
+ */
+static inline bool leggi_intero(const char** p, const char* fine, int* valore){
+    const char* q = *p;
+    bool negativo = false;
+    unsigned long long v = 0, limite;
+    
+    if(q < fine && (*q == '-' || *q == '+'))
+        negativo = (*q++ == '-');
+    
+    if(q == fine || *q < '0' || *q > '9')
+        return false;
+    
+    limite = negativo ? (unsigned long long) INT_MAX + 1 : (unsigned long long) INT_MAX;
+    
+    while(q < fine && *q >= '0' && *q <= '9'){
+        v = v * 10 + (*q++ - '0');
+        
+        if(v > limite)
+            return false;
+    }
+    
+    *valore = negativo ? (int) -(long long) v : (int) v;
+    *p = q;
+    
+    return true;
+}
+
+/**
+	@brief Funzione per la lettura di un operando, valore o riferimento "$k"
+
+	@param p Puntatore alla posizione corrente, avanzato dopo l'operando
+	@param fine Fine del testo
+	@param valore Valore letto (0 per un riferimento)
+	@param rif N° dell'operazione riferita (0 per un valore), NULL se i riferimenti non sono ammessi
+	@return true se è stato letto un operando valido
+ */
+static inline bool leggi_operando(const char** p, const char* fine, int* valore, unsigned int* rif){
+    int k;
+    
+    if(*p < fine && **p == '$'){
+        (*p)++;
+        
+        if(rif == NULL || !leggi_intero(p, fine, &k) || k < 1)
+            return false;
+        
+        *rif = k;
+        *valore = 0;
+        return true;
+    }
+    
+    if(rif != NULL)
+        *rif = 0;
+    
+    return leggi_intero(p, fine, valore);
+}
+
+/**
+	@brief Funzione per l'analisi di una linea contenente un'operazione
+
+	Legge dalla posizione *p una linea nel formato "id num1 op num2",
+	salvandone i campi in d, e avanza *p all'inizio della linea successiva.
+	L'operatore deve essere uno tra +, -, * e /.
+	@param p Puntatore alla posizione corrente nel testo
+	@param fine Fine del testo
+	@param d Struttura dati in cui salvare l'operazione letta
+	@param r Riferimenti degli operandi "$k" (operando in d a 0), NULL se non ammessi
+	@return 1 se è stata letta un'operazione, 0 se la linea è vuota, -1 se è malformata
+ */
+int analizza_linea(const char** p, const char* fine, dati* d, riferimento* r){
+    const char* q = salta_spazi(*p, fine);
+    
+    if(q == fine || *q == '\n' || *q == '\r')
+        return salta_linea(p, q, fine, 0);
+    
+    if(!leggi_intero(&q, fine, &d->id_sem))
+        return salta_linea(p, q, fine, -1);
+    
+    q = salta_spazi(q, fine);
+    if(!leggi_operando(&q, fine, &d->num1, r ? &r->op1 : NULL))
+        return salta_linea(p, q, fine, -1);
+    
+    q = salta_spazi(q, fine);
+    if(q == fine || !operatore_valido(*q))
+        return salta_linea(p, q, fine, -1);
+    d->op = *q++;
+    
+    q = salta_spazi(q, fine);
+    if(!leggi_operando(&q, fine, &d->num2, r ? &r->op2 : NULL))
+        return salta_linea(p, q, fine, -1);
+    
+    /**
+     Dopo il secondo operando sono ammessi solo spazi fino a fine linea.
+     */
+    q = salta_spazi(q, fine);
+    if(q < fine && *q != '\n' && *q != '\r')
+        return salta_linea(p, q, fine, -1);
+    
+    d->res_disponibile = false;
+    
+    return salta_linea(p, q, fine, 1);
+}
+
+/**
+	@brief Funzione per il conteggio delle linee non vuote di una parte del testo (thread)
+
+	Una linea è vuota se contiene solo spazi e tabulazioni, come per
+	analizza_linea(): il conteggio è quindi il n° esatto di operazioni della
+	parte, se nessuna linea è malformata. Cerca anche il carattere '$' per
+	sapere se serve il vettore dei riferimenti.
+	@param arg Parte da contare
+	@return NULL
+ */
+static void* conta_parte(void* arg){
+    parte* t = (parte *) arg;
+    const char *p = t->inizio, *q;
+    
+    t->n_operazioni = 0;
+    t->dollari = memchr(t->inizio, '$', t->fine - t->inizio) != NULL;
+    
+    while(p < t->fine){
+        q = salta_spazi(p, t->fine);
+        
+        if(q < t->fine && *q != '\n' && *q != '\r')
+            t->n_operazioni++;
+        
+        salta_linea(&p, q, t->fine, 0);
+    }
+    
+    return NULL;
+}
+
+/**
+	@brief Funzione per l'analisi di una parte del testo (thread)
+
+	Analizza le linee della parte finchè non ne trova una malformata,
+	salvando le operazioni direttamente nella porzione del vettore finale
+	assegnata alla parte, di dimensione pari al conteggio di conta_parte().<br>
+	Non verifica che i riferimenti indichino operazioni precedenti, perchè
+	la posizione delle operazioni nel file è nota solo dopo l'analisi di
+	tutte le parti.
+	@param arg Parte da analizzare
+	@return NULL
+ */
+static void* analizza_parte(void* arg){
+    parte* t = (parte *) arg;
+    const char* p = t->inizio;
+    riferimento r;
+    int n = 0, esito;
+    
+    t->righe = 0;
+    t->errore = false;
+    
+    while(p < t->fine){
+        esito = analizza_linea(&p, t->fine, &t->operazioni[n], &r);
+        t->righe++;
+        
+        if(esito == 1 && (t->operazioni[n].id_sem < 0 || t->operazioni[n].id_sem > t->numero_processi))
+            esito = -1;
+        
+        if(esito == -1){
+            t->errore = true;
+            break;
+        }
+        
+        if(esito == 1 && t->riferimenti != NULL)
+            t->riferimenti[n] = r;
+        
+        n += esito;
+    }
+    
+    return NULL;
+}
+
+/**
+	@brief Procedura di esecuzione di una funzione su tutte le parti del testo
+
+	La prima parte viene elaborata nel thread corrente, le altre in thread
+	dedicati (o nel thread corrente se la creazione del thread fallisce).
+	@param parti Parti del testo
+	@param n_parti N° di parti
+	@param funzione Funzione da eseguire su ciascuna parte
+ */
+static void elabora_parti(parte* parti, int n_parti, void* (*funzione)(void *)){
+    pthread_t thread[PARSER_MAX_THREAD];
+    bool avviato[PARSER_MAX_THREAD];
+    int k;
+    
+    for(k=0; k<n_parti; k++)
+        avviato[k] = k > 0 && pthread_create(&thread[k], NULL, funzione, &parti[k]) == 0;
+    
+    for(k=0; k<n_parti; k++){
+        if(avviato[k])
+            pthread_join(thread[k], NULL);
+        else
+            funzione(&parti[k]);
+    }
+}
+
+/**
+	@brief Funzione che restituisce il n° di thread con cui analizzare il testo
+
+	È il valore della variabile d'ambiente PARSER_ENV, se presente e valido,
+	altrimenti il n° di CPU su cui il processo può essere eseguito, al più
+	PARSER_MAX_THREAD.
+ */
+static int numero_analizzatori(void){
+    char* valore = getenv(PARSER_ENV);
+    cpu_set_t cpu;
+    int n = 1;
+    
+    if(valore != NULL && (n = atoi(valore)) >= 1)
+        return n < PARSER_MAX_THREAD ? n : PARSER_MAX_THREAD;
+    
+    if(sched_getaffinity(0, sizeof(cpu), &cpu) == 0)
+        n = CPU_COUNT(&cpu);
+    
+    return n < PARSER_MAX_THREAD ? n : PARSER_MAX_THREAD;
+}
+
+/**
+	@brief Funzione per la divisione del testo in parti allineate alle linee
+
+	Divide il testo in parti di dimensione simile, di almeno PARTE_MINIMA
+	byte, una per thread di analisi: ogni parte termina dopo il primo '\n'
+	che segue la posizione ideale di divisione.
+	@param p Inizio del testo (inizio di una linea)
+	@param fine Fine del testo
+	@param parti Vettore di PARSER_MAX_THREAD parti da inizializzare
+	@return N° di parti
+ */
+static int dividi_testo(const char* p, const char* fine, parte* parti){
+    size_t dimensione = fine - p;
+    const char* q;
+    int n = numero_analizzatori(), k;
+    
+    if(dimensione / PARTE_MINIMA < (size_t) n)
+        n = dimensione / PARTE_MINIMA > 0 ? (int) (dimensione / PARTE_MINIMA) : 1;
+    
+    for(k=0; k<n; k++){
+        parti[k].inizio = k == 0 ? p : parti[k-1].fine;
+        
+        if(k == n - 1){
+            parti[k].fine = fine;
+            continue;
+        }
+        
+        q = p + dimensione / n * (k + 1);
+        if(q < parti[k].inizio)
+            q = parti[k].inizio;
+        
+        q = memchr(q, '\n', fine - q);
+        parti[k].fine = q ? q + 1 : fine;
+    }
+    
+    return n;
+}
+
+/**
+	@brief Funzione di allocazione dei vettori finali e di assegnazione delle porzioni alle parti
+
+	Ogni parte riceve la porzione dei vettori che inizia dopo le operazioni
+	delle parti precedenti, nell'ordine del file.
+	@param parti Parti contate
+	@param n_parti N° di parti
+	@param l Struttura in cui allocare i vettori delle operazioni e dei riferimenti
+ */
+static void assegna_parti(parte* parti, int n_parti, lavoro* l){
+    bool riferimenti = false;
+    int k, i;
+    
+    l->n_operazioni = 0;
+    for(k=0; k<n_parti; k++){
+        l->n_operazioni += parti[k].n_operazioni;
+        riferimenti |= parti[k].dollari;
+    }
+    
+    l->operazioni = (dati *) malloc(sizeof(dati) * (l->n_operazioni + 1));
+    l->riferimenti = riferimenti ? (riferimento *) calloc(l->n_operazioni + 1, sizeof(riferimento)) : NULL;
+    
+    for(k=0, i=0; k<n_parti; i+=parti[k++].n_operazioni){
+        parti[k].operazioni = &l->operazioni[i];
+        parti[k].riferimenti = riferimenti ? &l->riferimenti[i] : NULL;
+    }
+}
+
+/**
+	@brief Funzione che restituisce la riga del file contenente un'operazione
+
+	Rianalizza la parte che contiene l'operazione, contando le linee fino a
+	raggiungerla (usata solo per i messaggi di errore).
+	@param parti Parti analizzate
+	@param indice Posizione dell'operazione nel vettore delle operazioni
+	@return N° della riga (da 1, la prima riga contiene il n° di processi)
+ */
+static int riga_operazione(const parte* parti, int indice){
+    const char* p;
+    dati d;
+    riferimento r;
+    int riga = 1, k = 0;
+    
+    while(indice >= parti[k].n_operazioni){
+        indice -= parti[k].n_operazioni;
+        riga += parti[k].righe;
+        k++;
+    }
+    
+    for(p = parti[k].inizio; p < parti[k].fine; riga++)
+        if(analizza_linea(&p, parti[k].fine, &d, &r) == 1 && indice-- == 0)
+            return riga + 1;
+    
+    return riga;
+}
+
+/**
+	@brief Funzione per il caricamento di un file di configurazione
+
+	Mappa in memoria il file: la prima riga contiene il n° di processi, le
+	successive le operazioni. Le linee vuote vengono ignorate.<br>
+	Le operazioni di un file di testo sono divise in parti allineate alle
+	linee, elaborate in parallelo da più thread in due passate: la prima
+	conta le operazioni di ogni parte, così che il vettore finale sia
+	allocato una sola volta, la seconda le analizza scrivendole direttamente
+	nella porzione del vettore assegnata alla parte.<br>
+	I file binari vengono convertiti direttamente record per record.<br>
+	Il vettore dei riferimenti viene allocato solo se il file contiene un
+	operando "$k"; ogni riferimento deve indicare un'operazione precedente.<br>
+	In caso di errore stampa un messaggio che indica il file e la riga.
+	@param percorso Percorso del file di configurazione
+	@param l Struttura in cui salvare il contenuto del file
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int carica_file(const char* percorso, lavoro* l){
+    int fd, riga = 1, n_parti, k, i;
+    struct stat st;
+    const char *testo, *p, *fine;
+    parte parti[PARSER_MAX_THREAD];
+    char messaggio[256];
+    
+    if((fd = open(percorso, O_RDONLY)) == -1 || fstat(fd, &st) == -1){
+        sprintf(messaggio, "ERRORE: Apertura file %s\n", percorso);
+        my_write(1, messaggio);
+        return -1;
+    }
+    
+    if(st.st_size == 0){
+        sprintf(messaggio, "ERRORE: Il file %s è vuoto\n", percorso);
+        my_write(1, messaggio);
+        close(fd);
+        return -1;
+    }
+    
+    /**
+     Mappo il file in sola lettura: il descrittore non serve più dopo la mmap().
+     */
+    testo = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(testo == MAP_FAILED){
+        sprintf(messaggio, "ERRORE: Mappatura in memoria del file %s\n", percorso);
+        my_write(1, messaggio);
+        return -1;
+    }
+    madvise((void *) testo, st.st_size, MADV_SEQUENTIAL);
+    
+    l->riferimenti = NULL;
+    p = testo;
+    fine = testo + st.st_size;
+    
+    /**
+     Un file binario contiene l'intestazione seguita da record di lunghezza
+     fissa, che converto direttamente nel vettore delle operazioni.
+     */
+    if(binario_riconosci(testo, st.st_size, MAGIC_OPERAZIONI)){
+        l->numero_processi = ((const intestazione_binaria *) testo)->valore;
+        l->n_operazioni = (st.st_size - sizeof(intestazione_binaria)) / sizeof(record_operazione);
+        l->operazioni = (dati *) malloc(sizeof(dati) * (l->n_operazioni + 1));
+        
+        for(riga=0; riga<l->n_operazioni; riga++){
+            binario_leggi_operazione((const record_operazione *) (p + sizeof(intestazione_binaria)) + riga, &l->operazioni[riga]);
+            
+            if(l->operazioni[riga].id_sem < 0 || l->operazioni[riga].id_sem > l->numero_processi
+               || !operatore_valido(l->operazioni[riga].op))
+                break;
+        }
+        
+        munmap((void *) testo, st.st_size);
+        
+        if(l->numero_processi < 1 || riga < l->n_operazioni){
+            sprintf(messaggio, "ERRORE: %s: record %d non valido\n", percorso, riga + 1);
+            my_write(1, messaggio);
+            free(l->operazioni);
+            return -1;
+        }
+        
+        return 0;
+    }
+    
+    /**
+     La prima riga contiene il n° di processi da creare.
+     */
+    p = salta_spazi(p, fine);
+    if(!leggi_intero(&p, fine, &l->numero_processi) || l->numero_processi < 1){
+        sprintf(messaggio, "ERRORE: %s:1: n° di processi non valido\n", percorso);
+        my_write(1, messaggio);
+        munmap((void *) testo, st.st_size);
+        return -1;
+    }
+    salta_linea(&p, p, fine, 0);
+    
+    /**
+     Divido le operazioni in parti, ne conto in parallelo le operazioni,
+     alloco i vettori finali e analizzo in parallelo le parti, ciascuna
+     nella propria porzione dei vettori.
+     */
+    n_parti = dividi_testo(p, fine, parti);
+    elabora_parti(parti, n_parti, conta_parte);
+    assegna_parti(parti, n_parti, l);
+    
+    for(k=0; k<n_parti; k++)
+        parti[k].numero_processi = l->numero_processi;
+    
+    elabora_parti(parti, n_parti, analizza_parte);
+    
+    /**
+     Cerco la prima parte che contiene una linea malformata, contando le
+     righe delle parti precedenti.
+     */
+    for(k=0; k<n_parti && !parti[k].errore; k++)
+        riga += parti[k].righe;
+    
+    if(k < n_parti){
+        sprintf(messaggio, "ERRORE: %s:%d: linea malformata\n", percorso, riga + parti[k].righe);
+        my_write(1, messaggio);
+        free(l->operazioni);
+        free(l->riferimenti);
+        munmap((void *) testo, st.st_size);
+        return -1;
+    }
+    
+    /**
+     Un riferimento deve indicare un'operazione precedente, così che le
+     dipendenze non contengano cicli.
+     */
+    for(i=0; l->riferimenti != NULL && i<l->n_operazioni; i++){
+        if(l->riferimenti[i].op1 > (unsigned int) i || l->riferimenti[i].op2 > (unsigned int) i){
+            sprintf(messaggio, "ERRORE: %s:%d: linea malformata\n", percorso, riga_operazione(parti, i));
+            my_write(1, messaggio);
+            free(l->operazioni);
+            free(l->riferimenti);
+            munmap((void *) testo, st.st_size);
+            return -1;
+        }
+    }
+    
+    munmap((void *) testo, st.st_size);
+    
+    return 0;
+}
+
+/**
+	@brief Funzione che legge nuovi dati nel buffer del lettore
+
+	Sposta all'inizio del buffer i dati non ancora analizzati e lo riempie
+	con una read(). Prima di bloccarsi esegue la procedura in_attesa finchè
+	l'input non ha dati disponibili.
+	@param r Lettore
+	@return 0 in caso di successo (o fine input), -1 in caso di errore
+ */
+static int riempi_lettore(lettore* r){
+    struct pollfd pfd = { r->fd, POLLIN, 0 };
+    ssize_t letti;
+    
+    memmove(r->buffer, r->buffer + r->inizio, r->fine - r->inizio);
+    r->fine -= r->inizio;
+    r->inizio = 0;
+    
+    if(r->fine == DIMENSIONE_LETTORE){
+        sprintf(sprintf_buffer, "ERRORE: %s:%d: linea troppo lunga\n", r->nome, r->riga + 1);
+        my_write(1, sprintf_buffer);
+        return -1;
+    }
+    
+    /**
+     Finchè l'input non ha dati disponibili eseguo la procedura di attesa,
+     che può ad esempio raccogliere i risultati pronti.
+     */
+    if(r->in_attesa != NULL){
+        while(poll(&pfd, 1, 0) == 0 && r->in_attesa())
+            poll(&pfd, 1, 1);
+    }
+    
+    do {
+        letti = read(r->fd, r->buffer + r->fine, DIMENSIONE_LETTORE - r->fine);
+    } while(letti == -1 && errno == EINTR);
+    
+    if(letti == -1){
+        sprintf(sprintf_buffer, "ERRORE: Lettura del file %s\n", r->nome);
+        my_write(1, sprintf_buffer);
+        return -1;
+    }
+    
+    if(letti == 0)
+        r->eof = true;
+    
+    r->fine += letti;
+    
+    return 0;
+}
+
+/**
+	@brief Funzione che restituisce la prossima linea completa del lettore
+
+	@param r Lettore
+	@param fine_linea Fine della linea (dopo l'eventuale '\n')
+	@return Inizio della linea, NULL a fine input o in caso di errore (r->eof falso)
+ */
+static const char* prossima_linea(lettore* r, const char** fine_linea){
+    const char *inizio, *nl;
+    
+    while(1){
+        inizio = r->buffer + r->inizio;
+        nl = memchr(inizio, '\n', r->fine - r->inizio);
+        
+        if(nl != NULL || (r->eof && r->inizio < r->fine)){
+            *fine_linea = nl ? nl + 1 : r->buffer + r->fine;
+            r->inizio = *fine_linea - r->buffer;
+            r->riga++;
+            return inizio;
+        }
+        
+        if(r->eof || riempi_lettore(r) == -1)
+            return NULL;
+    }
+}
+
+/**
+	@brief Funzione per l'apertura di un lettore incrementale
+
+	Apre il file indicato ("-" per lo standard input) e ne legge la prima
+	riga contenente il n° di processi, o l'intestazione se è binario.<br>
+	Se in_attesa non è NULL, mentre l'input non ha dati disponibili il
+	lettore la chiama ripetutamente (circa ogni millisecondo) finchè
+	restituisce true, poi si blocca in attesa dei dati.
+	@param r Lettore da inizializzare
+	@param percorso Percorso del file, "-" per lo standard input
+	@param in_attesa Procedura da eseguire durante l'attesa dei dati, o NULL
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int lettore_apri(lettore* r, const char* percorso, bool (*in_attesa)(void)){
+    const char *p, *fine;
+    
+    r->nome = strcmp(percorso, "-") == 0 ? "stdin" : percorso;
+    r->riga = 0;
+    r->inizio = 0;
+    r->fine = 0;
+    r->eof = false;
+    r->binario = false;
+    r->in_attesa = NULL;
+    
+    if(strcmp(percorso, "-") == 0)
+        r->fd = 0;
+    else if((r->fd = open(percorso, O_RDONLY)) == -1){
+        sprintf(sprintf_buffer, "ERRORE: Apertura file %s\n", percorso);
+        my_write(1, sprintf_buffer);
+        return -1;
+    }
+    
+    /**
+     Se l'input inizia con un'intestazione binaria ne leggo il n° di processi.
+     */
+    while(r->fine < sizeof(intestazione_binaria) && !r->eof)
+        if(riempi_lettore(r) == -1)
+            return -1;
+    
+    if(binario_riconosci(r->buffer, r->fine, MAGIC_OPERAZIONI)){
+        r->binario = true;
+        r->numero_processi = ((intestazione_binaria *) r->buffer)->valore;
+        r->inizio = sizeof(intestazione_binaria);
+        r->in_attesa = in_attesa;
+        return r->numero_processi >= 1 ? 0 : -1;
+    }
+    
+    /**
+     Altrimenti la prima riga contiene il n° di processi da creare.
+     */
+    if((p = prossima_linea(r, &fine)) == NULL){
+        sprintf(sprintf_buffer, "ERRORE: Il file %s è vuoto\n", r->nome);
+        my_write(1, sprintf_buffer);
+        return -1;
+    }
+    
+    p = salta_spazi(p, fine);
+    if(!leggi_intero(&p, fine, &r->numero_processi) || r->numero_processi < 1){
+        sprintf(sprintf_buffer, "ERRORE: %s:1: n° di processi non valido\n", r->nome);
+        my_write(1, sprintf_buffer);
+        return -1;
+    }
+    
+    r->in_attesa = in_attesa;
+    
+    return 0;
+}
+
+/**
+	@brief Funzione per la lettura della prossima operazione
+
+	@param r Lettore
+	@param d Struttura dati in cui salvare l'operazione letta
+	@return 1 se è stata letta un'operazione, 0 a fine input, -1 in caso di errore
+ */
+int lettore_operazione(lettore* r, dati* d){
+    const char *p, *fine;
+    int esito;
+    record_operazione record;
+    
+    /**
+     Nel formato binario leggo un record di lunghezza fissa.
+     */
+    if(r->binario){
+        while(r->fine - r->inizio < sizeof(record_operazione) && !r->eof)
+            if(riempi_lettore(r) == -1)
+                return -1;
+        
+        if(r->fine - r->inizio < sizeof(record_operazione))
+            return r->inizio == r->fine ? 0 : -1;
+        
+        memcpy(&record, r->buffer + r->inizio, sizeof(record));
+        binario_leggi_operazione(&record, d);
+        r->inizio += sizeof(record_operazione);
+        r->riga++;
+        
+        if(d->id_sem >= 0 && d->id_sem <= r->numero_processi && operatore_valido(d->op))
+            return 1;
+        
+        sprintf(sprintf_buffer, "ERRORE: %s: record %d non valido\n", r->nome, r->riga);
+        my_write(1, sprintf_buffer);
+        return -1;
+    }
+    
+    while((p = prossima_linea(r, &fine)) != NULL){
+        esito = analizza_linea(&p, fine, d, NULL);
+        
+        if(esito == 1 && (d->id_sem < 0 || d->id_sem > r->numero_processi))
+            esito = -1;
+        
+        if(esito == -1){
+            sprintf(sprintf_buffer, "ERRORE: %s:%d: linea malformata\n", r->nome, r->riga);
+            my_write(1, sprintf_buffer);
+            return -1;
+        }
+        
+        if(esito == 1)
+            return 1;
+    }
+    
+    return r->eof ? 0 : -1;
+}
+
+/**
+	@brief Procedura per la chiusura di un lettore
+
+	@param r Lettore
+ */
+void lettore_chiudi(lettore* r){
+    if(r->fd != 0)
+        close(r->fd);
+}
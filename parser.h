@@ -0,0 +1,138 @@
+/** @file parser.h
+
+	@brief Libreria per il caricamento del file di configurazione.
+
+	Il file viene mappato in memoria con mmap() e analizzato con uno scanner
+	di interi scritto a mano. Le operazioni sono divise in parti allineate
+	alle linee, di almeno PARTE_MINIMA byte, analizzate in parallelo da più
+	thread (uno per CPU disponibile o quanti indicati dalla variabile
+	d'ambiente PARSER_ENV, al più PARSER_MAX_THREAD): una prima passata conta
+	le operazioni di ogni parte, la seconda le analizza direttamente nella
+	porzione del vettore finale che spetta alla parte.<br>
+	In alternativa un lettore legge le operazioni una alla volta da un
+	descrittore qualsiasi (file, pipe, FIFO o standard input) con un buffer
+	di dimensione costante, per l'esecuzione in streaming.<br>
+	Entrambi riconoscono automaticamente i file di operazioni binari
+	(vedi binario.h).<br>
+	Nei file di testo caricati con carica_file() un operando può essere
+	"$k": il risultato della k-esima operazione del file (numerate da 1 come
+	nel file dei risultati), che deve precedere quella che lo usa. Le
+	dipendenze formano quindi un grafo aciclico, eseguito da elab2 in ordine
+	di dipendenza.
+ */
+
+#ifndef PARSER_H
+#define PARSER_H
+
+#include "functions.h"
+#include "binario.h"
+
+/**
+	Riferimenti degli operandi di un'operazione ai risultati di operazioni precedenti.
+ */
+typedef struct riferimento {
+    unsigned int op1;		/**< N° (da 1) dell'operazione il cui risultato è il primo operando, 0 se è un valore */
+    unsigned int op2;		/**< N° (da 1) dell'operazione il cui risultato è il secondo operando, 0 se è un valore */
+} riferimento;
+
+/**
+	Contenuto di un file di configurazione caricato in memoria.
+ */
+typedef struct lavoro {
+    int numero_processi;		/**< N° di processi letto dalla prima riga */
+    int n_operazioni;			/**< N° di operazioni lette */
+    dati* operazioni;			/**< Vettore delle operazioni, nell'ordine del file */
+    riferimento* riferimenti;	/**< Riferimenti degli operandi di ciascuna operazione, NULL se il file non ne contiene */
+} lavoro;
+
+#define DIMENSIONE_LETTORE 65536	/**< Dimensione del buffer del lettore (lunghezza massima di una linea) */
+#define PARSER_ENV "ELAB2_ANALIZZATORI"	/**< Variabile d'ambiente contenente il n° di thread di analisi di carica_file() */
+#define PARSER_MAX_THREAD 64			/**< N° massimo di thread di analisi */
+#define PARTE_MINIMA (1 << 20)			/**< Dimensione minima in byte della parte di testo analizzata da un thread */
+
+/**
+	Lettore incrementale di operazioni da un descrittore.
+ */
+typedef struct lettore {
+    int fd;								/**< Descrittore da cui leggere */
+    const char* nome;					/**< Nome del file, per i messaggi di errore */
+    int riga;							/**< N° dell'ultima riga letta */
+    int numero_processi;				/**< N° di processi letto dalla prima riga */
+    int inizio;							/**< Inizio dei dati non ancora analizzati nel buffer */
+    int fine;							/**< Fine dei dati letti nel buffer */
+    bool eof;							/**< Flag: raggiunta la fine dell'input */
+    bool binario;						/**< Flag: input in formato binario */
+    bool (*in_attesa)(void);			/**< Procedura chiamata mentre l'input non ha dati disponibili */
+    char buffer[DIMENSIONE_LETTORE];	/**< Buffer di lettura */
+} lettore;
+
+/**
+	@brief Funzione che verifica se un carattere è un operatore ammesso (+, -, *, /)
+
+	@param op Operatore
+	@return true se l'operatore è ammesso
+ */
+static inline bool operatore_valido(char op){
+    return op == '+' || op == '-' || op == '*' || op == '/';
+}
+
+/**
+	@brief Funzione per l'analisi di una linea contenente un'operazione
+
+	Legge dalla posizione *p una linea nel formato "id num1 op num2",
+	salvandone i campi in d, e avanza *p all'inizio della linea successiva.
+	L'operatore deve essere uno tra +, -, * e /.
+	@param p Puntatore alla posizione corrente nel testo
+	@param fine Fine del testo
+	@param d Struttura dati in cui salvare l'operazione letta
+	@param r Riferimenti degli operandi "$k" (operando in d a 0), NULL se non ammessi
+	@return 1 se è stata letta un'operazione, 0 se la linea è vuota, -1 se è malformata
+ */
+int analizza_linea(const char** p, const char* fine, dati* d, riferimento* r);
+
+/**
+	@brief Funzione per il caricamento di un file di configurazione
+
+	Mappa in memoria il file: la prima riga contiene il n° di processi, le
+	successive le operazioni, analizzate in parallelo a parti.
+	Le linee vuote vengono ignorate.<br>
+	I file binari vengono convertiti direttamente record per record.<br>
+	In caso di errore stampa un messaggio che indica il file e la riga.
+	@param percorso Percorso del file di configurazione
+	@param l Struttura in cui salvare il contenuto del file
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int carica_file(const char* percorso, lavoro* l);
+
+/**
+	@brief Funzione per l'apertura di un lettore incrementale
+
+	Apre il file indicato ("-" per lo standard input) e ne legge la prima
+	riga contenente il n° di processi, o l'intestazione se è binario.<br>
+	Se in_attesa non è NULL, mentre l'input non ha dati disponibili il
+	lettore la chiama ripetutamente (circa ogni millisecondo) finchè
+	restituisce true, poi si blocca in attesa dei dati.
+	@param r Lettore da inizializzare
+	@param percorso Percorso del file, "-" per lo standard input
+	@param in_attesa Procedura da eseguire durante l'attesa dei dati, o NULL
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int lettore_apri(lettore* r, const char* percorso, bool (*in_attesa)(void));
+
+/**
+	@brief Funzione per la lettura della prossima operazione
+
+	@param r Lettore
+	@param d Struttura dati in cui salvare l'operazione letta
+	@return 1 se è stata letta un'operazione, 0 a fine input, -1 in caso di errore
+ */
+int lettore_operazione(lettore* r, dati* d);
+
+/**
+	@brief Procedura per la chiusura di un lettore
+
+	@param r Lettore
+ */
+void lettore_chiudi(lettore* r);
+
+#endif
@@ -4,36 +4,50 @@
  *	Il programma è chiamato per ogni processo figlio creato in elab2 e riceve come argomenti
  *		- il numero del processore associato
  * 		- il numero di processi totali creato
+ * 		- l'id del segmento dei canali e gli identificatori dei vettori di
+ * 		  semafori empty e full, privati dell'istanza di elab2
+ * 		- l'id del segmento dell'area di appoggio, il n° di risultati che
+ * 		  contiene, se contiene il vettore dei tempi (0 o 1) e il n° di
+ * 		  voci della cache dei risultati (0 se non attiva)
  *
- *	La routine da eseguire:<br>
- *		- Attesa su un semaforo per eseguire un calcolo.<br>
- *		- Ricezione dei dati e dell'operazione da eseguire dal padre<br>
+ *	Il livello dei messaggi stampati è letto dalla variabile d'ambiente ELAB2_LOG.
+ *
+ *	La routine da eseguire, implementata in lavoratore.c:<br>
+ *		- Esecuzione a lotto, con il kernel vettoriale di calcolo.c, di tutte
+ *		  le operazioni accodate dal padre<br>
  *			- se ricevo 'K' termino l'esecuzione.<br>
- *		- Esecuzione del calcolo.<br>
- *		- Invio del risultato al padre e segnalazione della terminazione dei calcoli.<br>
+ *		- Se il canale è vuoto: esecuzione delle operazioni con id 0 della
+ *		  propria coda di lavoro o furto da quelle degli altri figli.<br>
+ *		- Se non c'è lavoro: attesa su un semaforo che il padre accodi operazioni.<br>
+ *		- Salvataggio dei risultati nell'area di appoggio (e nella cache dei
+ *		  risultati, se attiva) e pubblicazione al padre
+ *		  degli slot liberati, svegliandolo se attende spazio nel canale.<br>
  */
 #include "functions.h"
+#include "lavoratore.h"
+#include "attesa.h"
 
-int num1_figlio;				/**< Intero per la lettura del primo operando dal buffer */
-int num2_figlio; 				/**< Intero per la lettura del secondo operando dal buffer */
-char op_figlio;					/**< Char per la lettura dell'operatore dal buffer */
-dati* buffer_comune; 			/**< Buffer per la memoria condivisa */
+canale* buffer_comune; 			/**< Canali dei figli nella memoria condivisa */
 int numero_processi;  			/**< Numero di processi creati dal padre */
 int id; 						/**< Id del processo */
+area_appoggio appoggio;			/**< Area di appoggio dei risultati */
 
 int main(int argc, char *argv[]){
     
     /**
-     Inizializzo le variabili numero_processi e id con i valori passati come argomento.
+     Inizializzo le variabili numero_processi e id con i valori passati come argomento
+     e il livello di log con quello ereditato dal padre.
      */
     id=atoi(argv[1]);
     numero_processi=atoi(argv[2]);
+    log_inizializza();
+    attesa_inizializza();
     
     /**
      *	Recupero il vettore di semafori empty creato dal padre per coordinare
      *	le operazioni tra processi.
      */
-    if((semid_empty = semget(EMPTYKEY, numero_processi, 0777)) == -1){
+    if((semid_empty = sem_apri(atoi(argv[4]))) == -1){
         my_write(1, "						ERRORE: Recupero del vettore di semafori emptys\n");
         exit(1);
     }
@@ -42,96 +56,38 @@ int main(int argc, char *argv[]){
      *	Recupero il vettore di semafori full creato dal padre per coordinare
      *	le operazioni tra processi.
      */
-    if((semid_full = semget(FULLKEY, numero_processi, 0777)) == -1){
+    if((semid_full = sem_apri(atoi(argv[5]))) == -1){
         my_write(1, "						ERRORE: Recupero del vettore di semafori full\n");
         exit(1);
     }
     
     /**
-     *	Recupero il segmento di memoria condivisa creato dal padre.
+     *	Mappo il segmento di memoria condivisa dei canali creato dal padre
+     *	nell'area dati del figlio a partire dal primo indirizzo disponibile.
      */
-    if((shmid = shmget(SHMKEY, sizeof(dati) * numero_processi, 0777)) == -1){
-        my_write(1, "						ERRORE: Recupero del segmento di memoria condivisa\n");
+    shmid = atoi(argv[3]);
+    
+    if((buffer_comune = (canale *) shmat(shmid, 0, 0666)) == (canale *) -1){
+        my_write(1, "						ERRORE: Mappatura memoria condivisa nell'area dati del figlio\n");
         exit(1);
     }
     
     /**
-     *	Mappo la memoria condivisa nell'area dati del figlio a partire dal
-     *	primo indirizzo disponibile.
+     *	Mi collego all'area di appoggio creata dal padre, in cui salvo i risultati.
      */
-    if((buffer_comune = (dati *) shmat(shmid, 0, 0666)) == (dati *) -1){
-        my_write(1, "						ERRORE: Mappatura memoria condivisa nell'area dati del figlio\n");
+    if(appoggio_collega(&appoggio, atoi(argv[6]), atoi(argv[7]), atoi(argv[9]), atoi(argv[8])) == -1){
+        my_write(1, "						ERRORE: Mappatura dell'area di appoggio nell'area dati del figlio\n");
         exit(1);
     }
     
     /**
-     Entro in un ciclo infinito per l'esecuzione della routine.
+     Eseguo la routine di calcolo fino alla ricezione del segnale di terminazione,
+     quindi scollego la memoria condivisa dall'area dati del figlio e termino
+     con successo: il padre considera anomalo ogni altro stato di uscita.
      */
-    while(1){
-        /**
-         Attendo su un semaforo che il padre mi comunichi la presenza di operandi
-         nel buffer.
-         */
-        sem_wait(semid_full, id);
-        
-        /**
-         Quando sono disponibili operandi nel buffer eseguo la lettura
-         e salvo i valori nelle variabili create appositamente.
-         */
-        num1_figlio=(buffer_comune+id)->num1;
-        op_figlio=(buffer_comune+id)->op;
-        num2_figlio=(buffer_comune+id)->num2;
-        
-        /**
-         Se il padre non ha inviato il segnale di terminazione 'K' stampo
-         un messaggio di notifica della ricezione dei valori.<br>
-         */
-        if(op_figlio != 'K') {
-            sprintf(sprintf_buffer, "						#%d: Ho letto %d %c %d\n", id+1, num1_figlio, op_figlio, num2_figlio);
-            my_write(1, sprintf_buffer);
-            /**
-             Eseguo uno switch sull'operatore per poter riconoscere l'operazione
-             da svolgere e salvo il risultato ottenuto nel buffer comune.
-             */
-            switch(op_figlio){
-                case '+':
-                    (buffer_comune+id)->res=num1_figlio + num2_figlio;
-                    break;
-                case '-':
-                    (buffer_comune+id)->res=num1_figlio - num2_figlio;
-                    break;
-                case '*':
-                    (buffer_comune+id)->res=num1_figlio * num2_figlio;
-                    break;
-                case '/':
-                    (buffer_comune+id)->res=num1_figlio / num2_figlio;
-                    break;
-                default:
-                    break;
-            }
-        }
-        /**
-         Se il padre ha inviato il segnale di terminazione stampo un messaggio
-         di notifica terminazione, scollego la memoria condivisa dall'area dati
-         del figlio e termino l'esecuzione della routine.
-         */
-        else {
-            sprintf(sprintf_buffer, "						#%d: Ho letto 'K' -> Termino esecuzione\n", id+1);
-            my_write(1, sprintf_buffer);
-            
-            shmdt(buffer_comune);
-            exit(1);
-        }
-        
-        /**
-         Alzo la flag res_disponibile per segnalare al padre la presenza di un
-         risultato nel buffer del processo id.
-         */
-        (buffer_comune+id)->res_disponibile = true;
-        
-        /**
-         Segnalo al padre che ho terminato l'esecuzione dei calcoli
-         */
-        sem_signal(semid_empty, id);
-    }
-}
\ No newline at end of file
+    lavoratore_esegui(buffer_comune, numero_processi, &appoggio, id);
+    
+    shmdt(buffer_comune);
+    appoggio_rilascia(&appoggio);
+    exit(0);
+}
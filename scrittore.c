@@ -0,0 +1,233 @@
+/** @file scrittore.c
+
+	@brief Libreria per la scrittura bufferizzata dei risultati.
+ */
+#include "scrittore.h"
+
+/**
+	Coppie di cifre decimali da 00 a 99, per convertire due cifre alla volta.
+ */
+static const char coppie_cifre[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/**
+	@brief Funzione di conversione di un intero in testo
+
+	@param p Posizione in cui scrivere le cifre
+	@param v Intero da convertire
+	@return Posizione successiva all'ultima cifra scritta
+ */
+static inline char* scrivi_intero(char* p, int v){
+    char cifre[12];
+    char* q = cifre + sizeof(cifre);
+    unsigned int u = v < 0 ? 0u - (unsigned int) v : (unsigned int) v;
+    int n;
+    
+    while(u >= 100){
+        q -= 2;
+        memcpy(q, coppie_cifre + (u % 100) * 2, 2);
+        u /= 100;
+    }
+    
+    if(u >= 10){
+        q -= 2;
+        memcpy(q, coppie_cifre + u * 2, 2);
+    } else {
+        *--q = '0' + u;
+    }
+    
+    if(v < 0)
+        *p++ = '-';
+    
+    n = cifre + sizeof(cifre) - q;
+    memcpy(p, q, n);
+    
+    return p + n;
+}
+
+/**
+	@brief Funzione eseguita dal thread di scrittura
+
+	Attende che gli venga consegnato un buffer, lo scrive e segnala la
+	fine della scrittura, finchè non riceve la richiesta di terminazione.
+ */
+static void* thread_scrittura(void* arg){
+    scrittore* s = (scrittore *) arg;
+    size_t n;
+    int indice;
+    
+    pthread_mutex_lock(&s->mutex);
+    while(1){
+        while(s->da_scrivere == 0 && !s->fine)
+            pthread_cond_wait(&s->cond, &s->mutex);
+        
+        if(s->da_scrivere == 0)
+            break;
+        
+        /**
+         Il buffer consegnato è quello non in riempimento.
+         */
+        n = s->da_scrivere;
+        indice = 1 - s->corrente;
+        pthread_mutex_unlock(&s->mutex);
+        
+        if(scrivi_tutto(s->fd, s->buffer[indice], n) == -1)
+            s->errore = true;
+        
+        pthread_mutex_lock(&s->mutex);
+        s->da_scrivere = 0;
+        pthread_cond_broadcast(&s->cond);
+    }
+    pthread_mutex_unlock(&s->mutex);
+    
+    return NULL;
+}
+
+/**
+	@brief Funzione per l'inizializzazione di uno scrittore
+
+	@param s Scrittore da inizializzare
+	@param fd File descriptor su cui scrivere
+	@param thread true per scrivere in un thread dedicato
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int scrittore_apri(scrittore* s, int fd, bool thread){
+    s->fd = fd;
+    s->corrente = 0;
+    s->usati = 0;
+    s->errore = false;
+    s->thread = thread;
+    s->da_scrivere = 0;
+    s->fine = false;
+    s->buffer[0] = (char *) malloc(DIMENSIONE_SCRITTORE);
+    s->buffer[1] = thread ? (char *) malloc(DIMENSIONE_SCRITTORE) : NULL;
+    
+    if(s->buffer[0] == NULL || (thread && s->buffer[1] == NULL))
+        return -1;
+    
+    if(thread){
+        pthread_mutex_init(&s->mutex, NULL);
+        pthread_cond_init(&s->cond, NULL);
+        
+        if(pthread_create(&s->id_thread, NULL, thread_scrittura, s) != 0)
+            return -1;
+    }
+    
+    return 0;
+}
+
+/**
+	@brief Procedura che avvia la scrittura dei dati accodati
+
+	Con thread dedicato consegna il buffer al thread senza attendere la
+	fine della scrittura, altrimenti scrive immediatamente.
+ */
+void scrittore_svuota(scrittore* s){
+    if(s->usati == 0)
+        return;
+    
+    if(!s->thread){
+        if(scrivi_tutto(s->fd, s->buffer[0], s->usati) == -1)
+            s->errore = true;
+        s->usati = 0;
+        return;
+    }
+    
+    /**
+     Attendo che il thread abbia terminato la scrittura precedente, quindi
+     gli consegno il buffer corrente e continuo a riempire l'altro.
+     */
+    pthread_mutex_lock(&s->mutex);
+    while(s->da_scrivere != 0)
+        pthread_cond_wait(&s->cond, &s->mutex);
+    
+    s->da_scrivere = s->usati;
+    s->corrente = 1 - s->corrente;
+    s->usati = 0;
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+}
+
+/**
+	@brief Procedura per l'accodamento di n byte allo scrittore
+ */
+void scrittore_accoda(scrittore* s, const void* dati, size_t n){
+    if(s->usati + n > DIMENSIONE_SCRITTORE)
+        scrittore_svuota(s);
+    
+    memcpy(s->buffer[s->corrente] + s->usati, dati, n);
+    s->usati += n;
+}
+
+/**
+	@brief Procedura per l'accodamento di un risultato in formato testo
+
+	Scrive la riga "indice. n1 op n2 = res" come nel file res.txt.
+	@param s Scrittore
+	@param indice N° progressivo del risultato
+	@param r Risultato
+ */
+void scrittore_risultato(scrittore* s, int indice, const res* r){
+    char* p;
+    
+    /**
+     Una riga occupa al più 4 interi di 11 caratteri più 9 separatori.
+     */
+    if(s->usati + 64 > DIMENSIONE_SCRITTORE)
+        scrittore_svuota(s);
+    
+    p = s->buffer[s->corrente] + s->usati;
+    p = scrivi_intero(p, indice);
+    *p++ = '.';
+    *p++ = ' ';
+    p = scrivi_intero(p, r->n1);
+    *p++ = ' ';
+    *p++ = r->op;
+    *p++ = ' ';
+    p = scrivi_intero(p, r->n2);
+    memcpy(p, " = ", 3);
+    p = scrivi_intero(p + 3, r->res);
+    *p++ = '\n';
+    
+    s->usati = p - s->buffer[s->corrente];
+}
+
+/**
+	@brief Procedura per l'accodamento di un risultato in formato binario
+ */
+void scrittore_record(scrittore* s, const res* r){
+    record_risultato record;
+    
+    binario_scrivi_risultato(r, &record);
+    scrittore_accoda(s, &record, sizeof(record));
+}
+
+/**
+	@brief Funzione di chiusura di uno scrittore
+
+	Scrive tutti i dati accodati, termina l'eventuale thread e libera i
+	buffer. Il file descriptor non viene chiuso.
+	@param s Scrittore
+	@return 0 se tutte le scritture sono riuscite, -1 altrimenti
+ */
+int scrittore_chiudi(scrittore* s){
+    scrittore_svuota(s);
+    
+    if(s->thread){
+        pthread_mutex_lock(&s->mutex);
+        s->fine = true;
+        pthread_cond_broadcast(&s->cond);
+        pthread_mutex_unlock(&s->mutex);
+        
+        pthread_join(s->id_thread, NULL);
+        pthread_mutex_destroy(&s->mutex);
+        pthread_cond_destroy(&s->cond);
+        free(s->buffer[1]);
+    }
+    
+    free(s->buffer[0]);
+    
+    return s->errore ? -1 : 0;
+}
@@ -0,0 +1,88 @@
+/** @file scrittore.h
+
+	@brief Libreria per la scrittura bufferizzata dei risultati.
+
+	I risultati vengono formattati con una conversione intero-testo dedicata
+	in un buffer in spazio utente di grandi dimensioni, scritto con una sola
+	write() quando è pieno.<br>
+	Opzionalmente la scrittura avviene in un thread dedicato con doppio
+	buffer: mentre il thread scrive un buffer, il chiamante riempie l'altro.
+ */
+
+#ifndef SCRITTORE_H
+#define SCRITTORE_H
+
+#include "functions.h"
+#include "binario.h"
+
+#include <pthread.h>
+
+#define DIMENSIONE_SCRITTORE (1 << 20)	/**< Dimensione di ciascun buffer di scrittura */
+
+/**
+	Scrittore bufferizzato su un file descriptor.
+ */
+typedef struct scrittore {
+    int fd;							/**< File descriptor su cui scrivere */
+    char* buffer[2];				/**< Buffer di scrittura (il secondo solo con thread dedicato) */
+    int corrente;					/**< Indice del buffer in riempimento */
+    size_t usati;					/**< N° di byte presenti nel buffer in riempimento */
+    bool errore;					/**< Flag: almeno una scrittura è fallita */
+    
+    bool thread;					/**< Flag: scrittura in un thread dedicato */
+    pthread_t id_thread;			/**< Thread di scrittura */
+    pthread_mutex_t mutex;			/**< Mutex sui campi seguenti */
+    pthread_cond_t cond;			/**< Condizione di cambio di stato del buffer in scrittura */
+    size_t da_scrivere;				/**< N° di byte del buffer consegnato al thread, 0 se nessuno */
+    bool fine;						/**< Flag: il thread deve terminare */
+} scrittore;
+
+/**
+	@brief Funzione per l'inizializzazione di uno scrittore
+
+	@param s Scrittore da inizializzare
+	@param fd File descriptor su cui scrivere
+	@param thread true per scrivere in un thread dedicato
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int scrittore_apri(scrittore* s, int fd, bool thread);
+
+/**
+	@brief Procedura per l'accodamento di n byte allo scrittore
+ */
+void scrittore_accoda(scrittore* s, const void* dati, size_t n);
+
+/**
+	@brief Procedura per l'accodamento di un risultato in formato testo
+
+	Scrive la riga "indice. n1 op n2 = res" come nel file res.txt.
+	@param s Scrittore
+	@param indice N° progressivo del risultato
+	@param r Risultato
+ */
+void scrittore_risultato(scrittore* s, int indice, const res* r);
+
+/**
+	@brief Procedura per l'accodamento di un risultato in formato binario
+ */
+void scrittore_record(scrittore* s, const res* r);
+
+/**
+	@brief Procedura che avvia la scrittura dei dati accodati
+
+	Con thread dedicato consegna il buffer al thread senza attendere la
+	fine della scrittura, altrimenti scrive immediatamente.
+ */
+void scrittore_svuota(scrittore* s);
+
+/**
+	@brief Funzione di chiusura di uno scrittore
+
+	Scrive tutti i dati accodati, termina l'eventuale thread e libera i
+	buffer. Il file descriptor non viene chiuso.
+	@param s Scrittore
+	@return 0 se tutte le scritture sono riuscite, -1 altrimenti
+ */
+int scrittore_chiudi(scrittore* s);
+
+#endif
@@ -0,0 +1,262 @@
+/** @file sportello.c
+
+	@brief Libreria per l'invio di lavori al demone di elab2.
+ */
+#include "sportello.h"
+
+#include <sys/stat.h>
+
+/**
+	@brief Funzione che ricava le chiavi dello sportello dell'utente corrente
+
+	Le chiavi sono ricavate con ftok() dal file SPORTELLO_PERCORSO
+	dell'utente, che deve appartenergli e non essere un link simbolico, così
+	che un altro utente non possa imporre le chiavi dello sportello.
+	@param chiave_shm Chiave del segmento dello sportello
+	@param chiave_sem Chiave del vettore di semafori dello sportello
+	@param crea true per creare il file se non esiste (demone)
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+static int chiavi_sportello(key_t* chiave_shm, key_t* chiave_sem, bool crea){
+    char percorso[64];
+    struct stat info;
+    int fd;
+    
+    snprintf(percorso, sizeof(percorso), SPORTELLO_PERCORSO, (long) getuid());
+    
+    if((fd = open(percorso, O_RDONLY | O_NOFOLLOW | (crea ? O_CREAT : 0), 0600)) == -1)
+        return -1;
+    
+    if(fstat(fd, &info) == -1 || info.st_uid != getuid()){
+        close(fd);
+        return -1;
+    }
+    close(fd);
+    
+    if((*chiave_shm = ftok(percorso, SPORTELLO_PROGETTO_SHM)) == -1 || (*chiave_sem = ftok(percorso, SPORTELLO_PROGETTO_SEM)) == -1)
+        return -1;
+    
+    return 0;
+}
+
+/**
+	@brief Funzione che rimuove lo sportello lasciato da un demone terminato
+
+	Lo sportello è orfano se il segmento non esiste o se il demone annotato
+	nel segmento non è più in esecuzione: in tal caso rimuovo segmento e
+	semafori, svegliando i clienti ancora in attesa.
+	@param chiave_shm Chiave del segmento dello sportello
+	@param chiave_sem Chiave del vettore di semafori dello sportello
+	@return true se non c'è un demone in esecuzione, false altrimenti
+ */
+static bool rimuovi_orfano(key_t chiave_shm, key_t chiave_sem){
+    sportello* s;
+    int shmid, semid;
+    bool orfano = true;
+    
+    if((shmid = shmget(chiave_shm, 0, 0600)) != -1 && (s = (sportello *) shmat(shmid, 0, SHM_RDONLY)) != (sportello *) -1){
+        orfano = !processo_attivo(s->demone);
+        shmdt(s);
+    }
+    
+    if(!orfano)
+        return false;
+    
+    if(shmid != -1)
+        shmctl(shmid, IPC_RMID, NULL);
+    
+    if((semid = sem_collega(chiave_sem, 3)) != -1)
+        sem_rimuovi(semid);
+    
+    return true;
+}
+
+/**
+	@brief Funzione per la creazione dello sportello da parte del demone
+
+	Rimuove lo sportello lasciato da un demone terminato, quindi crea in
+	modo esclusivo segmento e semafori dello sportello, accessibili solo
+	all'utente corrente, e rende lo sportello disponibile ai clienti.
+	Il pid del demone è scritto nel segmento prima di creare i semafori.
+	@param a Accesso allo sportello da inizializzare
+	@param numero_processi N° di figli del demone
+	@return 0 in caso di successo, -1 in caso di errore (ad esempio se un
+	altro demone dell'utente è in esecuzione)
+ */
+int sportello_crea(accesso* a, int numero_processi){
+    key_t chiave_shm, chiave_sem;
+    
+    if(chiavi_sportello(&chiave_shm, &chiave_sem, true) == -1 || !rimuovi_orfano(chiave_shm, chiave_sem))
+        return -1;
+    
+    if((a->shmid = shmget(chiave_shm, sizeof(sportello), IPC_CREAT | IPC_EXCL | 0600)) == -1)
+        return -1;
+    
+    if((a->s = (sportello *) shmat(a->shmid, 0, 0)) == (sportello *) -1){
+        shmctl(a->shmid, IPC_RMID, NULL);
+        return -1;
+    }
+    
+    a->s->demone = getpid();
+    a->s->numero_processi = numero_processi;
+    
+    if((a->semid = sem_crea(chiave_sem, 3, 0)) == -1){
+        shmdt(a->s);
+        shmctl(a->shmid, IPC_RMID, NULL);
+        return -1;
+    }
+    
+    sem_signal(a->semid, SPORTELLO_LIBERO);
+    
+    return 0;
+}
+
+/**
+	@brief Procedura per la rimozione dello sportello da parte del demone
+
+	@param a Accesso allo sportello
+ */
+void sportello_rimuovi(accesso* a){
+    shmdt(a->s);
+    shmctl(a->shmid, IPC_RMID, NULL);
+    sem_rimuovi(a->semid);
+}
+
+/**
+	@brief Funzione per il collegamento di un cliente allo sportello del demone
+
+	@param a Accesso allo sportello da inizializzare
+	@return 0 in caso di successo, -1 se nessun demone dell'utente è in esecuzione
+ */
+int sportello_collega(accesso* a){
+    key_t chiave_shm, chiave_sem;
+    
+    if(chiavi_sportello(&chiave_shm, &chiave_sem, false) == -1)
+        return -1;
+    
+    if((a->semid = sem_collega(chiave_sem, 3)) == -1)
+        return -1;
+    
+    if((a->shmid = shmget(chiave_shm, sizeof(sportello), 0600)) == -1)
+        return -1;
+    
+    if((a->s = (sportello *) shmat(a->shmid, 0, 0)) == (sportello *) -1)
+        return -1;
+    
+    return 0;
+}
+
+/**
+	@brief Procedura per lo scollegamento di un cliente dallo sportello
+
+	@param a Accesso allo sportello
+ */
+void sportello_scollega(accesso* a){
+    shmdt(a->s);
+}
+
+/**
+	@brief Procedura di acquisizione dello sportello da parte di un cliente
+
+	Se lo sportello non si libera entro SPORTELLO_ATTESA ms controlla il
+	cliente che lo tiene: se è terminato senza rilasciarlo lo rilascia al
+	suo posto. Il confronto e scambio sul campo cliente fa sì che un solo
+	cliente in attesa esegua il rilascio.
+	@param a Accesso allo sportello
+ */
+static void prendi_sportello(accesso* a){
+    pid_t cliente;
+    
+    while(!sem_timedwait(a->semid, SPORTELLO_LIBERO, SPORTELLO_ATTESA)){
+        cliente = __atomic_load_n(&a->s->cliente, __ATOMIC_SEQ_CST);
+        
+        if(cliente != 0 && !processo_attivo(cliente)
+           && __atomic_compare_exchange_n(&a->s->cliente, &cliente, 0, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+            sem_signal(a->semid, SPORTELLO_LIBERO);
+    }
+    
+    __atomic_store_n(&a->s->cliente, getpid(), __ATOMIC_SEQ_CST);
+}
+
+/**
+	@brief Procedura di rilascio dello sportello da parte di un cliente
+
+	@param a Accesso allo sportello
+ */
+static void rilascia_sportello(accesso* a){
+    __atomic_store_n(&a->s->cliente, 0, __ATOMIC_SEQ_CST);
+    sem_signal(a->semid, SPORTELLO_LIBERO);
+}
+
+/**
+	@brief Funzione di invio di una richiesta al demone e di attesa della sua risposta
+
+	Scarta le risposte con un numero diverso da quello della richiesta,
+	destinate a un cliente terminato mentre teneva lo sportello.
+	@param a Accesso allo sportello
+	@return Esito della risposta
+ */
+static int richiedi(accesso* a){
+    unsigned int numero = a->s->richiesta + 1;
+    
+    __atomic_store_n(&a->s->richiesta, numero, __ATOMIC_SEQ_CST);
+    sem_signal(a->semid, SPORTELLO_RICHIESTA);
+    
+    do
+        sem_wait(a->semid, SPORTELLO_RISPOSTA);
+    while(__atomic_load_n(&a->s->risposta, __ATOMIC_SEQ_CST) != numero);
+    
+    return a->s->esito;
+}
+
+/**
+	@brief Funzione per l'esecuzione di un lavoro da parte del demone
+
+	Invia le operazioni al demone a lotti di al più SPORTELLO_CAPACITA
+	operazioni e ne attende i risultati, tenendo lo sportello per tutto il
+	lavoro. Le system call sui semafori rendono visibili i dati scritti
+	nello sportello all'altra parte.
+	@param a Accesso allo sportello
+	@param operazioni Vettore delle operazioni da eseguire
+	@param n N° di operazioni
+	@param risultati Vettore di n risultati in cui salvare i risultati, nell'ordine delle operazioni
+	@return 0 in caso di successo, -1 se il demone ha rifiutato un lotto
+	(operazione con id negativo o con operatore diverso da +, -, * e /)
+ */
+int sportello_esegui(accesso* a, const dati* operazioni, int n, res* risultati){
+    int k, lotto, esito = 0;
+    
+    prendi_sportello(a);
+    
+    for(k=0; k<n && esito == 0; k+=lotto){
+        lotto = n - k < SPORTELLO_CAPACITA ? n - k : SPORTELLO_CAPACITA;
+        
+        a->s->comando = SPORTELLO_ESEGUI;
+        a->s->n = lotto;
+        memcpy(a->s->operazioni, operazioni + k, sizeof(dati) * lotto);
+        
+        if((esito = richiedi(a)) == 0)
+            memcpy(risultati + k, a->s->risultati, sizeof(res) * lotto);
+    }
+    
+    rilascia_sportello(a);
+    
+    return esito;
+}
+
+/**
+	@brief Procedura di richiesta della terminazione del demone
+
+	Attende che il demone abbia terminato i figli e gli conferma la
+	ricezione della risposta. Lo sportello non viene rilasciato: il demone
+	lo rimuove terminando.
+	@param a Accesso allo sportello
+ */
+void sportello_arresta(accesso* a){
+    prendi_sportello(a);
+    
+    a->s->comando = SPORTELLO_ARRESTA;
+    
+    richiedi(a);
+    sem_signal(a->semid, SPORTELLO_RICHIESTA);
+}
@@ -0,0 +1,131 @@
+/** @file sportello.h
+
+	@brief Libreria per l'invio di lavori al demone di elab2.
+
+	Con l'opzione -D elab2 viene eseguito come demone: crea una sola volta
+	semafori, canali e figli, che restano collegati e inattivi tra un lavoro
+	e l'altro, e riceve i lavori dai clienti attraverso lo sportello, un
+	segmento di memoria condivisa contenente un lotto di al più
+	SPORTELLO_CAPACITA operazioni e i relativi risultati.<br>
+	L'accesso è regolato da un vettore di tre semafori:<br>
+	- SPORTELLO_LIBERO: mutua esclusione tra i clienti, un lavoro alla volta.<br>
+	- SPORTELLO_RICHIESTA: il cliente segnala al demone che il lotto è pronto.<br>
+	- SPORTELLO_RISPOSTA: il demone segnala al cliente che i risultati sono pronti.<br>
+	Un lavoro più grande della capacità dello sportello viene inviato in più
+	lotti consecutivi senza rilasciare lo sportello.<br>
+	Il cliente che tiene lo sportello ne scrive il pid nel campo cliente: chi
+	attende lo sportello controlla ogni SPORTELLO_ATTESA ms che il cliente
+	esista ancora e, se è terminato senza rilasciarlo, lo rilascia al suo
+	posto. Ogni richiesta è numerata e il demone riporta il numero nella
+	risposta, così che il nuovo cliente scarti la risposta destinata al
+	cliente terminato.<br>
+	Ogni utente ha il proprio sportello: le chiavi di semafori e segmento
+	sono ricavate con ftok() dal file SPORTELLO_PERCORSO dell'utente, creato
+	dal demone, e gli oggetti sono accessibili solo all'utente. Il demone
+	rimuove lo sportello lasciato da un demone terminato (vedi
+	processo_attivo()) prima di crearne uno nuovo.<br>
+	Gli id delle operazioni maggiori del n° di figli del demone sono
+	assegnati ciclicamente ai figli (id-1 modulo n° di figli, più 1).
+ */
+
+#ifndef SPORTELLO_H
+#define SPORTELLO_H
+
+#include "functions.h"
+
+#define SPORTELLO_PERCORSO ISTANZE_DIR "/elab2-%ld.sportello"	/**< File da cui sono ricavate le chiavi dello sportello, con l'uid dell'utente */
+#define SPORTELLO_PROGETTO_SHM 'M'	/**< Identificatore di progetto di ftok() per il segmento dello sportello */
+#define SPORTELLO_PROGETTO_SEM 'S'	/**< Identificatore di progetto di ftok() per i semafori dello sportello */
+#define SPORTELLO_CAPACITA 65536	/**< N° massimo di operazioni di un lotto */
+#define SPORTELLO_ATTESA 1000		/**< Intervallo di controllo del cliente che tiene lo sportello (ms) */
+
+#define SPORTELLO_LIBERO 0		/**< Semaforo di mutua esclusione tra i clienti */
+#define SPORTELLO_RICHIESTA 1	/**< Semaforo del lotto pronto per il demone */
+#define SPORTELLO_RISPOSTA 2	/**< Semaforo dei risultati pronti per il cliente */
+
+#define SPORTELLO_ESEGUI 0		/**< Comando: esegui il lotto */
+#define SPORTELLO_ARRESTA 1		/**< Comando: termina il demone */
+
+/**
+	Sportello del demone, nella memoria condivisa.
+ */
+typedef struct sportello {
+    pid_t demone;							/**< Pid del demone */
+    int numero_processi;					/**< N° di figli del demone */
+    int comando;							/**< Comando del cliente (SPORTELLO_ESEGUI o SPORTELLO_ARRESTA) */
+    int n;									/**< N° di operazioni del lotto */
+    pid_t cliente;							/**< Pid del cliente che tiene lo sportello, 0 se libero */
+    unsigned int richiesta;					/**< N° dell'ultima richiesta di un cliente */
+    unsigned int risposta;					/**< N° della richiesta a cui si riferisce la risposta del demone */
+    int esito;								/**< Esito della risposta: 0 lotto eseguito, -1 lotto rifiutato */
+    dati operazioni[SPORTELLO_CAPACITA];	/**< Operazioni del lotto */
+    res risultati[SPORTELLO_CAPACITA];		/**< Risultati del lotto, nell'ordine delle operazioni */
+} sportello;
+
+/**
+	Sportello collegato da un processo (demone o cliente).
+ */
+typedef struct accesso {
+    sportello* s;	/**< Sportello nell'area dati del processo */
+    int shmid;		/**< Identificatore del segmento dello sportello */
+    int semid;		/**< Identificatore del vettore di semafori dello sportello */
+} accesso;
+
+/**
+	@brief Funzione per la creazione dello sportello da parte del demone
+
+	@param a Accesso allo sportello da inizializzare
+	@param numero_processi N° di figli del demone
+	@return 0 in caso di successo, -1 in caso di errore (ad esempio se un
+	altro demone dell'utente è in esecuzione)
+ */
+int sportello_crea(accesso* a, int numero_processi);
+
+/**
+	@brief Procedura per la rimozione dello sportello da parte del demone
+
+	I clienti in attesa dello sportello vengono svegliati e terminano con un
+	errore, con entrambe le implementazioni dei semafori.
+	@param a Accesso allo sportello
+ */
+void sportello_rimuovi(accesso* a);
+
+/**
+	@brief Funzione per il collegamento di un cliente allo sportello del demone
+
+	@param a Accesso allo sportello da inizializzare
+	@return 0 in caso di successo, -1 se nessun demone dell'utente è in esecuzione
+ */
+int sportello_collega(accesso* a);
+
+/**
+	@brief Procedura per lo scollegamento di un cliente dallo sportello
+
+	@param a Accesso allo sportello
+ */
+void sportello_scollega(accesso* a);
+
+/**
+	@brief Funzione per l'esecuzione di un lavoro da parte del demone
+
+	Invia le operazioni al demone a lotti di al più SPORTELLO_CAPACITA
+	operazioni e ne attende i risultati, tenendo lo sportello per tutto il
+	lavoro.
+	@param a Accesso allo sportello
+	@param operazioni Vettore delle operazioni da eseguire
+	@param n N° di operazioni
+	@param risultati Vettore di n risultati in cui salvare i risultati, nell'ordine delle operazioni
+	@return 0 in caso di successo, -1 se il demone ha rifiutato un lotto
+	(operazione con id negativo o con operatore diverso da +, -, * e /)
+ */
+int sportello_esegui(accesso* a, const dati* operazioni, int n, res* risultati);
+
+/**
+	@brief Procedura di richiesta della terminazione del demone
+
+	Attende che il demone abbia terminato i figli.
+	@param a Accesso allo sportello
+ */
+void sportello_arresta(accesso* a);
+
+#endif
@@ -0,0 +1,68 @@
+/** @file statistiche.c
+
+	@brief Libreria per la misura delle prestazioni di una simulazione.
+ */
+#include "statistiche.h"
+#include "binario.h"
+
+#include <time.h>
+
+/**
+	@brief Funzione che restituisce l'istante corrente
+
+	Usa CLOCK_MONOTONIC, confrontabile tra padre e figli.
+	@return Nanosecondi trascorsi da un istante fisso, comune a tutti i processi
+ */
+long long statistiche_adesso(void){
+    struct timespec t;
+    
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    
+    return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+/**
+	@brief Procedura di inizializzazione delle misure
+
+	Azzera l'istogramma e registra l'istante di avvio del programma.
+	@param s Misure da inizializzare
+ */
+void statistiche_inizializza(statistiche* s){
+    memset(s, 0, sizeof(statistiche));
+    s->inizio = statistiche_adesso();
+}
+
+/**
+	@brief Funzione che aggiunge i risultati al file indicato come riga JSON
+
+	I tempi sono in millisecondi, le latenze in nanosecondi.
+	@param s Misure
+	@param file File a cui aggiungere la riga ("-" per lo standard error)
+	@param configurazione Coppie "chiave":valore JSON che descrivono la simulazione
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int statistiche_scrivi(const statistiche* s, const char* file, const char* configurazione){
+    char riga[1024];
+    int fd, n, esito;
+    double secondi = (s->fine - s->avvio) / 1e9;
+    
+    n = snprintf(riga, sizeof(riga),
+                 "{%s,\"operazioni\":%lld,\"avvio_ms\":%.3f,\"calcoli_ms\":%.3f,\"totale_ms\":%.3f,"
+                 "\"operazioni_al_secondo\":%.0f,\"latenza_ns\":{\"p50\":%lld,\"p90\":%lld,\"p99\":%lld,\"p999\":%lld,\"massimo\":%lld}}\n",
+                 configurazione, s->latenze.n,
+                 (s->avvio - s->inizio) / 1e6, (s->fine_calcoli - s->avvio) / 1e6, (s->fine - s->inizio) / 1e6,
+                 secondi > 0 ? s->latenze.n / secondi : 0.0,
+                 istogramma_percentile(&s->latenze, 50), istogramma_percentile(&s->latenze, 90),
+                 istogramma_percentile(&s->latenze, 99), istogramma_percentile(&s->latenze, 99.9), s->latenze.massimo);
+    
+    if(strcmp(file, "-") == 0)
+        return scrivi_tutto(2, riga, n);
+    
+    if((fd = open(file, O_WRONLY | O_CREAT | O_APPEND, 0644)) == -1)
+        return -1;
+    
+    esito = scrivi_tutto(fd, riga, n);
+    close(fd);
+    
+    return esito;
+}
@@ -0,0 +1,56 @@
+/** @file statistiche.h
+
+	@brief Libreria per la misura delle prestazioni di una simulazione.
+
+	Con l'opzione -S di elab2 vengono misurati il tempo di avvio (lettura
+	dell'input, creazione delle risorse e dei figli), il tempo dei calcoli,
+	il tempo totale e la latenza di ogni operazione, dall'accodamento da parte
+	del padre al salvataggio del risultato da parte del figlio.<br>
+	Le latenze sono raccolte in un istogramma a memoria costante (vedi
+	istogramma.h), da cui vengono ricavati i percentili.<br>
+	Al termine viene aggiunta al file indicato una riga JSON con i risultati.
+ */
+
+#ifndef STATISTICHE_H
+#define STATISTICHE_H
+
+#include "functions.h"
+#include "istogramma.h"
+
+/**
+	Misure raccolte durante una simulazione.
+ */
+typedef struct statistiche {
+    long long inizio;			/**< Istante di avvio del programma (ns) */
+    long long avvio;			/**< Istante di inizio dell'invio delle operazioni (ns) */
+    long long fine_calcoli;		/**< Istante di terminazione dei figli (ns) */
+    long long fine;				/**< Istante di fine della scrittura dei risultati (ns) */
+    istogramma latenze;			/**< Istogramma delle latenze delle operazioni (ns) */
+} statistiche;
+
+/**
+	@brief Funzione che restituisce l'istante corrente
+
+	@return Nanosecondi trascorsi da un istante fisso, comune a tutti i processi
+ */
+long long statistiche_adesso(void);
+
+/**
+	@brief Procedura di inizializzazione delle misure
+
+	Azzera l'istogramma e registra l'istante di avvio del programma.
+	@param s Misure da inizializzare
+ */
+void statistiche_inizializza(statistiche* s);
+
+/**
+	@brief Funzione che aggiunge i risultati al file indicato come riga JSON
+
+	@param s Misure
+	@param file File a cui aggiungere la riga ("-" per lo standard error)
+	@param configurazione Coppie "chiave":valore JSON che descrivono la simulazione
+	@return 0 in caso di successo, -1 in caso di errore
+ */
+int statistiche_scrivi(const statistiche* s, const char* file, const char* configurazione);
+
+#endif